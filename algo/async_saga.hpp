@@ -0,0 +1,295 @@
+#pragma once
+
+#include "lib/utils.hpp"
+#include "lib/sampler.hpp"
+#include "lib/numa.hpp"
+#include "lib/sparse_accumulator.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace VRSGD {
+
+/*
+ * Central parameter store of async_saga_train. It owns w and the gradient
+ * table average; workers pull copies of w and push the gradient table
+ * changes of their batches, summed in their own SparseAccumulators.
+ *
+ * w and table_avg are split into blocks of features, each behind its own
+ * lock, and a push walks the blocks in order. The dense part of the update,
+ * table_avg * alpha and the prox, is applied block by block with the sparse
+ * batch change in one pass, so concurrent pushes pipeline over the blocks
+ * instead of queueing for the whole vector. A pulled w may mix blocks of
+ * consecutive versions, as in Hogwild.
+ *
+ * Bounded staleness (stale synchronous parallel): every worker has a clock
+ * counting its pushes, and a worker may not run more than staleness pushes
+ * ahead of the slowest worker.
+ */
+template <typename T>
+class ParameterStore {
+   public:
+    ParameterStore(int w_feature_num, int num_worker, int staleness)
+        : w(w_feature_num), table_avg(w_feature_num),
+          block_size(std::max(kMinBlockSize, (w_feature_num + 8 * num_worker - 1) / (8 * num_worker))),
+          block_mutex((w_feature_num + block_size - 1) / block_size), clocks(num_worker, 0), staleness(staleness) {}
+
+    // Adds a worker's initial table sum; returns once all workers did so
+    void init_table(const DenseVector<T>& table_sum, int data_num) {
+        std::unique_lock<std::mutex> lock(mutex);
+        table_avg += table_sum / (T)data_num;
+        if (++num_ready == (int)clocks.size()) {
+            cv.notify_all();
+        } else {
+            cv.wait(lock, [&]() { return num_ready == (int)clocks.size(); });
+        }
+    }
+
+    void pull(DenseVector<T>& w_local) {
+        for (int block = 0; block < num_blocks(); block++) {
+            std::lock_guard<std::mutex> lock(block_mutex[block]);
+            for (int fea = block_begin(block); fea < block_end(block); fea++) {
+                w_local[fea] = w[fea];
+            }
+        }
+    }
+
+    /*
+     * Applies one batch, the same update as saga_train:
+     * w = prox(w - alpha * (w_change / batch_size + table_avg))
+     * table_avg += table_change / data_num
+     * where w_change sums weight_k * (grad_k - old_grad_k) over the batch and
+     * table_change the unweighted differences.
+     *
+     * prox_func must be separable over the features except a trailing
+     * intercept it leaves alone, which all problems are: a block other than
+     * the last is proxed with a spare trailing entry in the intercept's place.
+     *
+     * @return the number of batches applied so far, over all workers
+     */
+    template <typename ProblemT>
+    long long push(int worker, const SparseAccumulator<T>& w_change, const SparseAccumulator<T>& table_change,
+                   int batch_size, ProblemT& problem, double alpha, double lambda, int data_num) {
+        for (int block = 0; block < num_blocks(); block++) {
+            int begin = block_begin(block);
+            int end = block_end(block);
+            DenseVector<T> y(end - begin + (block + 1 < num_blocks() ? 1 : 0));
+
+            std::lock_guard<std::mutex> lock(block_mutex[block]);
+            for (int fea = begin; fea < end; fea++) {
+                y[fea - begin] = w[fea] - (T)alpha * table_avg[fea] - (T)(alpha / batch_size) * w_change[fea];
+                table_avg[fea] += (T)(1. / data_num) * table_change[fea];
+            }
+            y = problem.prox_func(y, alpha, lambda);
+            for (int fea = begin; fea < end; fea++) {
+                w[fea] = y[fea - begin];
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        clocks[worker]++;
+        cv.notify_all();
+        return ++version;
+    }
+
+    // Blocks while the worker is more than staleness pushes ahead
+    void wait_clock(int worker) {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&]() { return stop || clocks[worker] - min_clock() <= staleness; });
+    }
+
+    // A finished worker no longer holds the others back
+    void finish(int worker) {
+        std::lock_guard<std::mutex> lock(mutex);
+        clocks[worker] = -1;
+        cv.notify_all();
+    }
+
+    void request_stop() {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+        cv.notify_all();
+    }
+
+    inline bool stopped() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stop;
+    }
+
+   private:
+    long long min_clock() const {
+        long long res = -1;
+        for (long long clock : clocks) {
+            if (clock >= 0 && (res < 0 || clock < res)) {
+                res = clock;
+            }
+        }
+        return res < 0 ? 0 : res;
+    }
+
+    static const int kMinBlockSize = 1024;
+
+    inline int num_blocks() const { return block_mutex.size(); }
+
+    inline int block_begin(int block) const { return block * block_size; }
+
+    inline int block_end(int block) const { return std::min((block + 1) * block_size, w.get_feature_num()); }
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    DenseVector<T> w;
+    DenseVector<T> table_avg;
+    int block_size;
+    std::vector<std::mutex> block_mutex;
+    std::vector<long long> clocks;
+    long long version = 0;
+    int num_ready = 0;
+    int staleness;
+    bool stop = false;
+};
+
+// Rows [begin, end) of a problem, for partition-local sampling
+template <typename ProblemT>
+class ProblemPartition {
+   public:
+    ProblemPartition(ProblemT& problem, int begin, int end) : problem(problem), begin(begin), end(end) {}
+
+    inline double smoothness(int idx) { return problem.smoothness(begin + idx); }
+
+    inline int size() const { return end - begin; }
+
+   private:
+    ProblemT& problem;
+    int begin;
+    int end;
+};
+
+/*
+ * Asynchronous SAGA on num_threads worker threads. The rows are split into
+ * one contiguous partition per worker, and each worker keeps the gradient
+ * table of its own rows. A worker samples a batch from its partition using
+ * a possibly stale copy of w, then pushes the batch's gradient differences to
+ * the ParameterStore, which holds the global table average and applies the
+ * update.
+ *
+ * @param num_iter
+ * batches over all workers, as in saga_train
+ *
+ * @param staleness
+ * pushes a worker may run ahead of the slowest one; it also refreshes its copy
+ * of w every staleness + 1 pushes. 0 makes the workers advance in lockstep
+ *
+ * @param sampler
+ * copied for every worker, with the generator reseeded to its own stream
+ *
+ * @param report
+ * called every sample_period batches from the worker completing that batch,
+ * calls are serialized. Returning false stops all workers
+ *
+ * @param topology
+ * if not null, every worker is pinned to a CPU of its NUMA node, see
+ * numa_parallel_for. Its gradient table and its copy of w, the per-worker
+ * replica synced every staleness + 1 pushes, are then allocated on that node.
+ * Run numa_place_rows with num_threads beforehand to move the rows of each
+ * partition there too
+ *
+ * @return the final w
+ */
+
+template<typename T, typename U, bool is_sparse, typename ProblemT, typename SamplerT = Sampler<>>
+DenseVector<T> async_saga_train(ProblemT& problem, double alpha, double lambda, int batch_size, int num_iter, int w_feature_num, int sample_period, int num_threads, int staleness, SamplerT sampler = SamplerT(), const ReportFunc& report = print_progress, const NumaTopology* topology = nullptr) {
+    typedef decltype(std::declval<ProblemT>().grad_func(DenseVector<T>(), 0)) Vector_grad;
+    typedef typename std::decay<decltype(sampler.get_gen())>::type RNG;
+
+    int data_num = problem.size();
+    int num_worker = num_threads <= 1 || data_num < num_threads ? 1 : num_threads;
+    uint64_t seed = sampler.get_gen()();
+
+    ParameterStore<T> store(w_feature_num, num_worker, staleness);
+    std::mutex report_mutex;
+    if (!report(0, problem.cost_func(DenseVector<T>(w_feature_num)))) {
+        return DenseVector<T>(w_feature_num);
+    }
+
+    numa_parallel_for(data_num, num_worker, topology, [&](int begin, int end, int worker) {
+        ProblemPartition<ProblemT> partition(problem, begin, end);
+        SamplerT local_sampler = sampler;
+        local_sampler.get_gen() = RNG(seed, worker);
+        local_sampler.init(partition);
+
+        DenseVector<T> w(w_feature_num);
+        std::vector<Vector_grad> table;
+        DenseVector<T> table_sum(w_feature_num);
+        for (int i = begin; i < end; i++) {
+            table.emplace_back(problem.grad_func(w, i));
+            table_sum += table.back();
+        }
+        store.init_table(table_sum, data_num);
+
+        int worker_iter = (long long)num_iter * (worker + 1) / num_worker - (long long)num_iter * worker / num_worker;
+
+        // Sums of grad - table[row] over the batch, weighted by the sampler for w
+        SparseAccumulator<T> table_change(w_feature_num);
+        SparseAccumulator<T> weighted_change(local_sampler.is_weighted() ? w_feature_num : 0);
+        SparseAccumulator<T>& batch_w_change = local_sampler.is_weighted() ? weighted_change : table_change;
+        std::vector<std::pair<int, Vector_grad>> batch_table;
+
+        for (int i = 0; i < worker_iter && !store.stopped(); i++) {
+            // The temporaries of the iteration live in the arena, see lib/allocator.hpp
+            ArenaScope scratch;
+
+            store.wait_clock(worker);
+            if (i % (staleness + 1) == 0) {
+                store.pull(w);
+            }
+
+            // As in saga_train, all rows of a batch see the table from
+            // before the batch
+            batch_table.clear();
+            table_change.clear();
+            weighted_change.clear();
+            for (int j = 0; j < batch_size; j++) {
+                int row = local_sampler.next();
+                auto grad = problem.grad_func(w, begin + row);
+                table_change.add(grad, 1);
+                table_change.add(table[row], -1);
+                if (local_sampler.is_weighted()) {
+                    T weight = local_sampler.weight(row);
+                    weighted_change.add(grad, weight);
+                    weighted_change.add(table[row], -weight);
+                }
+                batch_table.emplace_back(row, std::move(grad));
+            }
+            for (auto& batch_item : batch_table) {
+                table[batch_item.first] = batch_item.second;
+            }
+
+            long long version = store.push(worker, batch_w_change, table_change, batch_size, problem, alpha, lambda,
+                                           data_num);
+            if (version % sample_period == 0 && version < num_iter) {
+                DenseVector<T> w_report(w_feature_num);
+                store.pull(w_report);
+                std::lock_guard<std::mutex> lock(report_mutex);
+                if (!report(version, problem.cost_func(w_report))) {
+                    store.request_stop();
+                }
+            }
+        }
+        store.finish(worker);
+    });
+
+    DenseVector<T> w(w_feature_num);
+    store.pull(w);
+    if (!store.stopped()) {
+        report(num_iter, problem.cost_func(w));
+    }
+
+    return w;
+}
+
+}
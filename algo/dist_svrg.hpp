@@ -0,0 +1,111 @@
+#pragma once
+
+#include "lib/utils.hpp"
+#include "lib/sampler.hpp"
+#include "lib/sparse_accumulator.hpp"
+
+#include <vector>
+
+namespace VRSGD {
+
+/*
+ * Data-parallel SVRG. Every worker calls dist_svrg_train with its own shard
+ * as problem and a transport connecting it to the other workers, see
+ * lib/transport.hpp. All workers must use the same arguments except for the
+ * problem and the sampler.
+ *
+ * The snapshot gradient mu_tidle is the shard gradients summed by one
+ * all-reduce, so it is the full gradient over all shards. The inner loop
+ * then runs on the local shard only, and every avg_period inner iterations
+ * (and before each snapshot) w is averaged over the workers.
+ *
+ * @param avg_period
+ * inner iterations between model averages, <= 0 averages only before the
+ * snapshots
+ *
+ * @param report
+ * called on rank 0 only, with the cost over all shards. Its return value is
+ * broadcast so that all workers stop together
+ *
+ * @return the final w, identical on all workers
+ */
+
+template<typename T, typename U, bool is_sparse, typename ProblemT, typename TransportT, typename SamplerT = Sampler<>>
+DenseVector<T> dist_svrg_train(ProblemT& problem, TransportT& transport, double alpha, double lambda, int batch_size, int num_iter, int num_inner_iter, int w_feature_num, int avg_period, int sample_period, SamplerT sampler = SamplerT(), const ReportFunc& report = print_progress) {
+    DenseVector<T> w_tidle(w_feature_num);
+    DenseVector<T> w(w_feature_num);
+    DenseVector<T> mu_tidle(w_feature_num);
+    SparseAccumulator<T> batch_w_change(w_feature_num);
+
+    int data_num = problem.size();
+    int num_worker = transport.size();
+    double total_num = data_num;
+    transport.allreduce_sum(&total_num, 1);
+
+    // cost_func is an average over the shard, so the global cost weights
+    // every shard by its size
+    auto report_global = [&](int num_effective_pass) {
+        double msg[2] = {data_num * problem.cost_func(w), 0};
+        transport.allreduce_sum(msg, 1);
+        msg[1] = transport.rank() == 0 && !report(num_effective_pass, msg[0] / total_num);
+        transport.allreduce_sum(msg + 1, 1);
+        return msg[1] == 0;
+    };
+
+    auto average = [&]() {
+        transport.allreduce_sum(&w[0], w_feature_num);
+        w /= num_worker;
+    };
+
+    int num_effective_pass = 0;
+    sampler.init(problem);
+
+    for (int i = 0; i < num_iter; i++) {
+        average();
+        w_tidle = w;
+
+        mu_tidle.set_zero();
+        for (int i = 0; i < data_num; i++) {
+            mu_tidle += problem.grad_func(w_tidle, i);
+        }
+        transport.allreduce_sum(&mu_tidle[0], w_feature_num);
+        mu_tidle /= total_num;
+
+        for (int j = 0; j < num_inner_iter; j++) {
+            if (num_effective_pass % sample_period == 0 && !report_global(num_effective_pass)) {
+                // All workers stop here together
+                average();
+                return w;
+            }
+
+            batch_w_change.clear();
+            for (int k = 0; k < batch_size; k++) {
+                int rand_row = sampler.next();
+
+                auto grad = problem.grad_func(w, rand_row);
+                auto grad_snapshot = problem.grad_func(w_tidle, rand_row);
+
+                T weight = sampler.weight(rand_row);
+                batch_w_change.add(grad, weight);
+                batch_w_change.add(grad_snapshot, -weight);
+            }
+
+            // w = prox(w - alpha * (batch_w_change / batch_size + mu_tidle))
+            w -= mu_tidle * (T)alpha;
+            batch_w_change.apply(w, -alpha / batch_size);
+            w = problem.prox_func(w, alpha, lambda);
+
+            num_effective_pass++;
+            if (avg_period > 0 && num_effective_pass % avg_period == 0) {
+                average();
+            }
+        }
+    }
+
+    average();
+    report_global(num_effective_pass);
+
+    return w;
+}
+
+}
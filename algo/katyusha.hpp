@@ -0,0 +1,137 @@
+#pragma once
+
+#include "lib/utils.hpp"
+#include "lib/sampler.hpp"
+#include "lib/sparse_accumulator.hpp"
+#include "lib/trace.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace VRSGD {
+
+/*
+ * Katyusha (Allen-Zhu 2017): SVRG snapshots plus Nesterov momentum and the
+ * "negative momentum" pull towards the snapshot w_tidle. Every inner
+ * iteration combines three sequences,
+ *   x = tau1 * z + 1/2 * w_tidle + (1/2 - tau1) * y
+ *   g = the SVRG estimate at x
+ *   z = prox(z - step * g, step),  step = 1 / (3 tau1 L)
+ *   y = prox(x - g / (3 L), 1 / (3 L))
+ * and the next snapshot is a weighted average of the y of the outer iteration.
+ *
+ * @param L
+ * Lipschitz constant of grad_func(w, idx), see max_smoothness()
+ *
+ * @param sigma
+ * strong convexity of the objective, e.g. lambda for RidgeRegression
+ * > 0: tau1 = min(sqrt(num_inner_iter * sigma / (3 L)), 1/2)
+ * <= 0: the non strongly convex schedule, tau1 = 2 / (outer iteration + 4)
+ *
+ * @param report
+ * receives (num_effective_pass, cost of y) every sample_period inner
+ * iterations, training stops once it returns false
+ *
+ * @return the final snapshot w_tidle
+ */
+
+template<typename T, typename U, bool is_sparse, typename ProblemT, typename SamplerT = Sampler<>>
+DenseVector<T> katyusha_train(ProblemT& problem, double L, double sigma, double lambda, int batch_size, int num_iter, int num_inner_iter, int w_feature_num, int sample_period, SamplerT sampler = SamplerT(), const ReportFunc& report = print_progress) {
+    DenseVector<T> w_tidle(w_feature_num);
+    DenseVector<T> mu_tidle(w_feature_num);
+    DenseVector<T> x(w_feature_num);
+    DenseVector<T> y(w_feature_num);
+    DenseVector<T> z(w_feature_num);
+    DenseVector<T> g(w_feature_num);
+    DenseVector<T> y_sum(w_feature_num);
+    SparseAccumulator<T> batch_g_change(w_feature_num);
+
+    int data_num = problem.size();
+    int num_effective_pass = 0;
+    double tau2 = 0.5;
+    double y_step = 1. / (3. * L);
+    sampler.init(problem);
+
+    for (int i = 0; i < num_iter; i++) {
+        double tau1 = sigma > 0 ? std::min(std::sqrt(num_inner_iter * sigma / (3. * L)), 0.5) : 2. / (i + 4);
+        double z_step = 1. / (3. * tau1 * L);
+        // y of inner iteration j is weighted by (1 + z_step * sigma)^j
+        double growth = sigma > 0 ? 1. + z_step * sigma : 1.;
+
+        {
+            // Phases are timed when built with -DVRSGD_TRACE, see lib/trace.hpp
+            VRSGD_TRACE_SCOPE(PHASE_FULL_GRAD);
+            mu_tidle.set_zero();
+            for (int k = 0; k < data_num; k++) {
+                ArenaScope scratch;
+                mu_tidle += problem.grad_func(w_tidle, k) / data_num;
+            }
+        }
+
+        y_sum.set_zero();
+        double weight = 1., weight_sum = 0.;
+        for (int j = 0; j < num_inner_iter; j++) {
+            // The temporaries of the iteration live in the arena, see lib/allocator.hpp
+            ArenaScope scratch;
+
+            if (num_effective_pass % sample_period == 0 && !report(num_effective_pass, VRSGD_TRACED(PHASE_COST, problem.cost_func(y)))) {
+                return y;
+            }
+
+            {
+                VRSGD_TRACE_SCOPE(PHASE_UPDATE);
+                for (int f = 0; f < w_feature_num; f++) {
+                    x[f] = tau1 * z[f] + tau2 * w_tidle[f] + (1. - tau1 - tau2) * y[f];
+                }
+            }
+
+            batch_g_change.clear();
+            for (int k = 0; k < batch_size; k++) {
+                int rand_row = sampler.next();
+
+                auto grad = VRSGD_TRACED(PHASE_GRAD, problem.grad_func(x, rand_row));
+                auto grad_snapshot = VRSGD_TRACED(PHASE_GRAD, problem.grad_func(w_tidle, rand_row));
+
+                VRSGD_TRACE_SCOPE(PHASE_UPDATE);
+                T row_weight = sampler.weight(rand_row);
+                batch_g_change.add(grad, row_weight);
+                batch_g_change.add(grad_snapshot, -row_weight);
+            }
+
+            // g = batch_g_change / batch_size + mu_tidle, then the z and y steps
+            {
+                VRSGD_TRACE_SCOPE(PHASE_UPDATE);
+                g = mu_tidle;
+                batch_g_change.apply(g, (T)1. / batch_size);
+                z.add_scaled(g, (T)-z_step);
+                y = x;
+                y.add_scaled(g, (T)-y_step);
+            }
+            z = VRSGD_TRACED(PHASE_PROX, problem.prox_func(z, z_step, lambda));
+            y = VRSGD_TRACED(PHASE_PROX, problem.prox_func(y, y_step, lambda));
+
+            VRSGD_TRACE_SCOPE(PHASE_UPDATE);
+            y_sum.add_scaled(y, (T)weight);
+            weight_sum += weight;
+            weight *= growth;
+            if (weight > 1e100) {
+                y_sum /= weight;
+                weight_sum /= weight;
+                weight = 1.;
+            }
+
+            num_effective_pass++;
+        }
+
+        if (weight_sum > 0) {
+            w_tidle = y_sum / weight_sum;
+        }
+    }
+
+    report(num_effective_pass, VRSGD_TRACED(PHASE_COST, problem.cost_func(w_tidle)));
+
+    return w_tidle;
+}
+
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "lib/utils.hpp"
+#include "lib/sampler.hpp"
+#include "lib/sparse_accumulator.hpp"
+#include "lib/trace.hpp"
+
+#include <vector>
+
+namespace VRSGD {
+
+/*
+ * Loopless SVRG: no outer loop, after every batch the snapshot is moved to
+ * the current w with probability snapshot_prob and the full gradient is
+ * recomputed. The expected cost of the refreshes is the same as SVRG with
+ * num_inner_iter = 1 / snapshot_prob, without a fixed full-pass pause.
+ *
+ * @param num_iter
+ * batches, as in saga_train
+ *
+ * @param snapshot_prob
+ * <= 0: batch_size / data_num, one refresh per pass over the data in expectation
+ *
+ * @param sampler
+ * row selection schedule, see lib/sampler.hpp; also draws the refreshes
+ *
+ * @param report
+ * receives (iteration, cost) every sample_period batches, training stops
+ * once it returns false
+ *
+ * @return the final w
+ */
+
+template<typename T, typename U, bool is_sparse, typename ProblemT, typename SamplerT = Sampler<>>
+DenseVector<T> loopless_svrg_train(ProblemT& problem, double alpha, double lambda, int batch_size, int num_iter, int w_feature_num, double snapshot_prob, int sample_period, SamplerT sampler = SamplerT(), const ReportFunc& report = print_progress) {
+    DenseVector<T> w_tidle(w_feature_num);
+    DenseVector<T> w(w_feature_num);
+    DenseVector<T> mu_tidle(w_feature_num);
+    SparseAccumulator<T> batch_w_change(w_feature_num);
+
+    int data_num = problem.size();
+    if (snapshot_prob <= 0) {
+        snapshot_prob = (double)batch_size / data_num;
+    }
+    sampler.init(problem);
+
+    bool refresh = true;
+    for (int i = 0; i < num_iter; i++) {
+        if (refresh) {
+            // Phases are timed when built with -DVRSGD_TRACE, see lib/trace.hpp
+            VRSGD_TRACE_SCOPE(PHASE_FULL_GRAD);
+            w_tidle = w;
+
+            mu_tidle.set_zero();
+            for (int k = 0; k < data_num; k++) {
+                ArenaScope scratch;
+                mu_tidle += problem.grad_func(w_tidle, k) / data_num;
+            }
+        }
+
+        // The temporaries of the iteration live in the arena, see lib/allocator.hpp
+        ArenaScope scratch;
+
+        if (i % sample_period == 0 && !report(i, VRSGD_TRACED(PHASE_COST, problem.cost_func(w)))) {
+            return w;
+        }
+
+        batch_w_change.clear();
+        for (int k = 0; k < batch_size; k++) {
+            int rand_row = sampler.next();
+
+            auto grad = VRSGD_TRACED(PHASE_GRAD, problem.grad_func(w, rand_row));
+            auto grad_snapshot = VRSGD_TRACED(PHASE_GRAD, problem.grad_func(w_tidle, rand_row));
+
+            VRSGD_TRACE_SCOPE(PHASE_UPDATE);
+            T weight = sampler.weight(rand_row);
+            batch_w_change.add(grad, weight);
+            batch_w_change.add(grad_snapshot, -weight);
+        }
+
+        // w = prox(w - alpha * (batch_w_change / batch_size + mu_tidle))
+        {
+            VRSGD_TRACE_SCOPE(PHASE_UPDATE);
+            w -= mu_tidle * (T)alpha;
+            batch_w_change.apply(w, -alpha / batch_size);
+        }
+        w = VRSGD_TRACED(PHASE_PROX, problem.prox_func(w, alpha, lambda));
+
+        refresh = uniform_real(sampler.get_gen()) < snapshot_prob;
+    }
+
+    report(num_iter, VRSGD_TRACED(PHASE_COST, problem.cost_func(w)));
+
+    return w;
+}
+
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "lib/utils.hpp"
+#include "lib/sampler.hpp"
+#include "lib/weight_block.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace VRSGD {
+
+/*
+ * SAGA for num_output models sharing the rows, see MultiOutputProblem. Every
+ * sampled row is read once and updates all outputs. Since the gradient of a
+ * linear model at row i is x_i times a scalar per output, the gradient table
+ * holds only the num_output residuals of each row instead of full gradients.
+ *
+ * The other parameters are as in saga_train; w_feature_num is the number of
+ * weight rows (feature_num + 1 with an intercept).
+ *
+ * @return the feature_num x num_output weights, column k is model k
+ */
+
+template<typename T, typename U, bool is_sparse, typename ProblemT, typename SamplerT = Sampler<>>
+WeightBlock<T> multi_saga_train(ProblemT& problem, double alpha, double lambda, int batch_size, int num_iter, int w_feature_num, int sample_period, SamplerT sampler = SamplerT(), const ReportFunc& report = print_progress) {
+    int data_num = problem.size();
+    int num_output = problem.get_num_output();
+    bool intercept = problem.has_intercept();
+
+    WeightBlock<T> w(w_feature_num, num_output);
+    WeightBlock<T> table_avg(w_feature_num, num_output);
+    std::vector<T> table((std::size_t)data_num * num_output);
+
+    std::vector<int> batch_rows(batch_size);
+    std::vector<T> batch_res((std::size_t)batch_size * num_output);
+    std::vector<T> batch_diff((std::size_t)batch_size * num_output);
+    std::vector<T> weighted_diff(num_output);
+
+    sampler.init(problem);
+
+    for (int i = 0; i < data_num; i++) {
+        T* res = &table[(std::size_t)i * num_output];
+        problem.residual_func(w, i, res);
+        table_avg.add_outer(problem.get_x(i), intercept, res, (T)1. / data_num);
+    }
+
+    for (int i = 0; i < num_iter; i++) {
+        if (i % sample_period == 0 && !report(i, problem.cost_func(w))) {
+            return w;
+        }
+
+        // All rows of the batch are evaluated at the same w
+        for (int j = 0; j < batch_size; j++) {
+            int rand_row = sampler.next();
+            T* res = &batch_res[(std::size_t)j * num_output];
+            T* diff = &batch_diff[(std::size_t)j * num_output];
+            const T* old_res = &table[(std::size_t)rand_row * num_output];
+
+            problem.residual_func(w, rand_row, res);
+            for (int k = 0; k < num_output; k++) {
+                diff[k] = res[k] - old_res[k];
+            }
+            batch_rows[j] = rand_row;
+        }
+
+        w.axpy(-alpha, table_avg);
+
+        for (int j = 0; j < batch_size; j++) {
+            int row = batch_rows[j];
+            const auto& x = problem.get_x(row);
+            T* diff = &batch_diff[(std::size_t)j * num_output];
+            T weight = sampler.weight(row);
+
+            for (int k = 0; k < num_output; k++) {
+                weighted_diff[k] = diff[k] * weight;
+            }
+            w.add_outer(x, intercept, weighted_diff.data(), -alpha / batch_size);
+            table_avg.add_outer(x, intercept, diff, (T)1. / data_num);
+
+            const T* res = batch_res.data() + (std::size_t)j * num_output;
+            std::copy(res, res + num_output, table.data() + (std::size_t)row * num_output);
+        }
+        problem.prox_func(w, alpha, lambda);
+    }
+
+    report(num_iter, problem.cost_func(w));
+
+    return w;
+}
+
+}
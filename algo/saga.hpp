@@ -1,68 +1,245 @@
 #pragma once
 
 #include "lib/utils.hpp"
+#include "lib/sampler.hpp"
+#include "lib/sparse_accumulator.hpp"
+#include "lib/trace.hpp"
 
+#include <cstdint>
+#include <fstream>
+#include <string>
 #include <vector>
 #include <functional>
 #include <random>
 
 namespace VRSGD {
 
-template<typename T, typename U, bool is_sparse, typename ProblemT>
-void saga_train(ProblemT problem, double alpha, double lambda, int batch_size, int num_iter, int w_feature_num, int sample_period) {
-    typedef LabeledPoint<Vector<T, is_sparse>, U> LabeledPoint_;
-    typedef Vector<T, is_sparse> Vector_data;
-    typedef decltype(std::declval<ProblemT>().grad_func(DenseVector<T>(), 0)) Vector_grad;
+/*
+ * Solver state of saga_train kept between runs: w, the gradient table and its
+ * mean. Rows appended to the problem since the run that left it get their
+ * table entries at w, the old entries stay as they are, so training on newly
+ * arrived data does not start over, see saga_train_incremental().
+ */
+template <typename T, typename Vector_grad>
+struct SagaState {
+    // Value-initialized, so that an empty state has 0 features
+    DenseVector<T> w{};
+    DenseVector<T> table_avg{};
+    std::vector<Vector_grad> table;
+};
+
+template <typename T, typename ProblemT>
+using SagaStateOf = SagaState<T, decltype(std::declval<ProblemT>().grad_func(DenseVector<T>(), 0))>;
+
+// Binary: "VRSGDSAG", w_feature_num, rows, w, table_avg, then the nonzeros of
+// every table entry as in write_binary()
+template <typename T, typename Vector_grad>
+bool save_saga_state(const SagaState<T, Vector_grad>& state, const std::string& filename) {
+    std::ofstream fs(filename, std::ofstream::binary);
+    int32_t feature_num = state.w.get_feature_num();
+    int64_t data_num = state.table.size();
+    fs.write("VRSGDSAG", 8);
+    fs.write((const char*)&feature_num, sizeof(feature_num));
+    fs.write((const char*)&data_num, sizeof(data_num));
+    for (int i = 0; i < feature_num; i++) {
+        double val = state.w[i];
+        fs.write((const char*)&val, sizeof(val));
+    }
+    for (int i = 0; i < feature_num; i++) {
+        double val = state.table_avg[i];
+        fs.write((const char*)&val, sizeof(val));
+    }
 
-    std::random_device rd;
-    std::mt19937 gen(rd());
+    std::vector<std::pair<int32_t, double>> entries;
+    for (const auto& grad : state.table) {
+        entries.clear();
+        for (auto it = grad.begin_feaval(); it != grad.end_feaval(); ++it) {
+            const auto& entry = *it;
+            if (entry.val != 0) {
+                entries.emplace_back(entry.fea, entry.val);
+            }
+        }
 
-    std::uniform_int_distribution<> dis_num_sample(0, problem.size() - 1);
+        int32_t nnz = entries.size();
+        fs.write((const char*)&nnz, sizeof(nnz));
+        for (const auto& entry : entries) {
+            fs.write((const char*)&entry.first, sizeof(entry.first));
+            fs.write((const char*)&entry.second, sizeof(entry.second));
+        }
+    }
+    return (bool)fs;
+}
 
-    DenseVector<T> table_avg(w_feature_num);
-    DenseVector<T> w(w_feature_num);
-    std::vector<Vector_grad> table;
+// false if filename is missing, not a saga state or corrupt, state is then
+// unchanged
+template <typename T, typename Vector_grad>
+bool load_saga_state(SagaState<T, Vector_grad>& state, const std::string& filename) {
+    std::ifstream fs(filename, std::ifstream::binary);
+    char magic[8];
+    int32_t feature_num;
+    int64_t data_num;
+    fs.read(magic, 8);
+    fs.read((char*)&feature_num, sizeof(feature_num));
+    fs.read((char*)&data_num, sizeof(data_num));
+    if (!fs || std::string(magic, 8) != "VRSGDSAG" || feature_num < 0 || data_num < 0) {
+        return false;
+    }
 
-    DenseVector<T> batch_w_change(w_feature_num);
-    std::vector<std::pair<int, Vector_grad>> batch_table;
-    DenseVector<T> table_sum_change(w_feature_num);
+    SagaState<T, Vector_grad> res;
+    res.w = DenseVector<T>(feature_num);
+    res.table_avg = DenseVector<T>(feature_num);
+    for (int i = 0; i < feature_num; i++) {
+        double val;
+        fs.read((char*)&val, sizeof(val));
+        res.w[i] = val;
+    }
+    for (int i = 0; i < feature_num; i++) {
+        double val;
+        fs.read((char*)&val, sizeof(val));
+        res.table_avg[i] = val;
+    }
+
+    res.table.reserve(std::min<int64_t>(data_num, 1 << 20));
+    for (int64_t i = 0; i < data_num; i++) {
+        int32_t nnz;
+        fs.read((char*)&nnz, sizeof(nnz));
+        if (!fs || nnz < 0 || nnz > feature_num) {
+            return false;
+        }
+        Vector_grad grad(feature_num);
+        for (int32_t j = 0; j < nnz; j++) {
+            int32_t fea;
+            double val;
+            fs.read((char*)&fea, sizeof(fea));
+            fs.read((char*)&val, sizeof(val));
+            if (!fs || fea < 0 || fea >= feature_num) {
+                return false;
+            }
+            grad.set(fea, val);
+        }
+        res.table.push_back(std::move(grad));
+    }
+    if (!fs) {
+        return false;
+    }
+    state = std::move(res);
+    return true;
+}
 
+// w_feature_num of the saga state in filename, -1 if it is missing or not a
+// saga state
+inline int saga_state_feature_num(const std::string& filename) {
+    std::ifstream fs(filename, std::ifstream::binary);
+    char magic[8];
+    int32_t feature_num;
+    fs.read(magic, 8);
+    fs.read((char*)&feature_num, sizeof(feature_num));
+    if (!fs || std::string(magic, 8) != "VRSGDSAG" || feature_num < 0) {
+        return -1;
+    }
+    return feature_num;
+}
+
+/*
+ * saga_train resuming from state, which receives the state at the end.
+ * Rows [state.table.size(), problem.size()) are the ones added since state
+ * was left, only they are evaluated before the first step; an empty table
+ * with w set warm-starts from w. A state of another w_feature_num or of more
+ * rows than the problem has is discarded.
+ *
+ * Sampler::focus() spends most of a short run on the new rows.
+ */
+template<typename T, typename U, bool is_sparse, typename ProblemT, typename Vector_grad, typename SamplerT = Sampler<>>
+void saga_train_incremental(ProblemT problem, double alpha, double lambda, int batch_size, int num_iter, int w_feature_num, int sample_period, SagaState<T, Vector_grad>& state, SamplerT sampler = SamplerT(), const ReportFunc& report = print_progress) {
     int data_num = problem.size();
-    for (int i = 0; i < data_num; i++) {
-        table.emplace_back(problem.grad_func(w, i));
-        table_avg += table[i];
+    if (state.w.get_feature_num() != w_feature_num) {
+        state.w = DenseVector<T>(w_feature_num);
+        state.table.clear();
+    }
+    if (state.table_avg.get_feature_num() != w_feature_num || (int)state.table.size() > data_num) {
+        state.table.clear();
+    }
+    if (state.table.empty()) {
+        state.table_avg = DenseVector<T>(w_feature_num);
+    }
+
+    DenseVector<T>& table_avg = state.table_avg;
+    DenseVector<T>& w = state.w;
+    std::vector<Vector_grad>& table = state.table;
+    sampler.init(problem);
+
+    // Sums of grad - table[row] over the batch, weighted by the sampler for w
+    SparseAccumulator<T> table_change(w_feature_num);
+    SparseAccumulator<T> weighted_change(sampler.is_weighted() ? w_feature_num : 0);
+    SparseAccumulator<T>& batch_w_change = sampler.is_weighted() ? weighted_change : table_change;
+    std::vector<std::pair<int, Vector_grad>> batch_table;
+
+    {
+        // Phases are timed when built with -DVRSGD_TRACE, see lib/trace.hpp
+        VRSGD_TRACE_SCOPE(PHASE_FULL_GRAD);
+        int old_num = table.size();
+        table.reserve(data_num);
+        table_avg *= (double)old_num;
+        for (int i = old_num; i < data_num; i++) {
+            table.emplace_back(problem.grad_func(w, i));
+            table_avg += table[i];
+        }
+        table_avg /= (double)data_num;
     }
-    table_avg /= (double)data_num;
 
     for (int i = 0; i < num_iter; i++) {
-        if (i % sample_period == 0) {
-            printf("%d %.15f\n", i, problem.cost_func(w));
+        // The temporaries of the iteration live in the arena, see lib/allocator.hpp
+        ArenaScope scratch;
+
+        if (i % sample_period == 0 && !report(i, VRSGD_TRACED(PHASE_COST, problem.cost_func(w)))) {
+            return;
         }
 
-        batch_w_change.set_zero();
         batch_table.clear();
-        table_sum_change.set_zero();
+        table_change.clear();
+        weighted_change.clear();
 
         for (int j = 0; j < batch_size; j++) {
-            int rand_row = dis_num_sample(gen);
+            int rand_row = sampler.next();
 
-            auto grad = problem.grad_func(w, rand_row);
+            auto grad = VRSGD_TRACED(PHASE_GRAD, problem.grad_func(w, rand_row));
+
+            VRSGD_TRACE_SCOPE(PHASE_UPDATE);
             batch_table.emplace_back(rand_row, grad);
 
-            batch_w_change -= alpha * (grad - (table[rand_row] - table_avg));
+            table_change.add(grad, 1);
+            table_change.add(table[rand_row], -1);
+            if (sampler.is_weighted()) {
+                T weight = sampler.weight(rand_row);
+                weighted_change.add(grad, weight);
+                weighted_change.add(table[rand_row], -weight);
+            }
+        }
 
-            table_sum_change += grad - table[rand_row];
+        // w = prox(w - alpha * (batch_w_change / batch_size + table_avg))
+        {
+            VRSGD_TRACE_SCOPE(PHASE_UPDATE);
+            w -= table_avg * (T)alpha;
+            batch_w_change.apply(w, -alpha / batch_size);
         }
+        w = VRSGD_TRACED(PHASE_PROX, problem.prox_func(w, alpha, lambda));
 
-        // TODO: may hurt performance by not using +=?
-        w = problem.prox_func(w + batch_w_change / batch_size, alpha, lambda);
-        table_avg += table_sum_change / (double)data_num;
+        VRSGD_TRACE_SCOPE(PHASE_UPDATE);
+        table_change.apply(table_avg, (T)1. / data_num);
         for (auto& batch_item : batch_table) {
             table[batch_item.first] = batch_item.second;
         }
     }
 
-    printf("%d %.15lf\n", num_iter, problem.cost_func(w));
+    report(num_iter, VRSGD_TRACED(PHASE_COST, problem.cost_func(w)));
+}
+
+template<typename T, typename U, bool is_sparse, typename ProblemT, typename SamplerT = Sampler<>>
+DenseVector<T> saga_train(ProblemT problem, double alpha, double lambda, int batch_size, int num_iter, int w_feature_num, int sample_period, SamplerT sampler = SamplerT(), const ReportFunc& report = print_progress) {
+    SagaStateOf<T, ProblemT> state;
+    saga_train_incremental<T, U, is_sparse>(problem, alpha, lambda, batch_size, num_iter, w_feature_num, sample_period,
+                                            state, sampler, report);
+    return std::move(state.w);
 }
 
 }
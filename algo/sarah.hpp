@@ -0,0 +1,104 @@
+#pragma once
+
+#include "lib/utils.hpp"
+#include "lib/sampler.hpp"
+#include "lib/sparse_accumulator.hpp"
+#include "lib/trace.hpp"
+
+#include <vector>
+
+namespace VRSGD {
+
+/*
+ * SARAH / SPIDER. Every outer iteration starts from the full gradient v at
+ * the current w, then the estimate is updated recursively,
+ *   v = grad_i(w) - grad_i(w_prev) + v
+ * instead of being anchored to a fixed snapshot as in SVRG. With a prox this
+ * is ProxSARAH; SPIDER uses the same estimator with a fixed epoch length.
+ *
+ * @param num_inner_iter
+ * maximum inner iterations per outer iteration
+ *
+ * @param inner_stop_ratio
+ * 0: always run num_inner_iter inner iterations (SARAH, SPIDER)
+ * > 0: SARAH+, the outer iteration also ends once
+ *      ||v||^2 <= inner_stop_ratio * ||v_0||^2
+ *
+ * @param report
+ * receives (num_effective_pass, cost) every sample_period inner iterations,
+ * training stops once it returns false
+ *
+ * @return the final w
+ */
+
+template<typename T, typename U, bool is_sparse, typename ProblemT, typename SamplerT = Sampler<>>
+DenseVector<T> sarah_train(ProblemT& problem, double alpha, double lambda, int batch_size, int num_iter, int num_inner_iter, int w_feature_num, double inner_stop_ratio, int sample_period, SamplerT sampler = SamplerT(), const ReportFunc& report = print_progress) {
+    DenseVector<T> w_prev(w_feature_num);
+    DenseVector<T> w(w_feature_num);
+    DenseVector<T> v(w_feature_num);
+    SparseAccumulator<T> batch_v_change(w_feature_num);
+
+    int data_num = problem.size();
+    int num_effective_pass = 0;
+    sampler.init(problem);
+
+    for (int i = 0; i < num_iter; i++) {
+        {
+            // Phases are timed when built with -DVRSGD_TRACE, see lib/trace.hpp
+            VRSGD_TRACE_SCOPE(PHASE_FULL_GRAD);
+            v.set_zero();
+            for (int k = 0; k < data_num; k++) {
+                ArenaScope scratch;
+                v += problem.grad_func(w, k) / data_num;
+            }
+        }
+        double stop_norm_sqr = inner_stop_ratio * v.norm_sqr();
+
+        for (int j = 0; j < num_inner_iter; j++) {
+            // The temporaries of the iteration live in the arena, see lib/allocator.hpp
+            ArenaScope scratch;
+
+            if (num_effective_pass % sample_period == 0 && !report(num_effective_pass, VRSGD_TRACED(PHASE_COST, problem.cost_func(w)))) {
+                return w;
+            }
+
+            // w = prox(w - alpha * v)
+            {
+                VRSGD_TRACE_SCOPE(PHASE_UPDATE);
+                w_prev = w;
+                w -= v * (T)alpha;
+            }
+            w = VRSGD_TRACED(PHASE_PROX, problem.prox_func(w, alpha, lambda));
+            num_effective_pass++;
+
+            batch_v_change.clear();
+            for (int k = 0; k < batch_size; k++) {
+                int rand_row = sampler.next();
+
+                auto grad = VRSGD_TRACED(PHASE_GRAD, problem.grad_func(w, rand_row));
+                auto grad_prev = VRSGD_TRACED(PHASE_GRAD, problem.grad_func(w_prev, rand_row));
+
+                VRSGD_TRACE_SCOPE(PHASE_UPDATE);
+                T weight = sampler.weight(rand_row);
+                batch_v_change.add(grad, weight);
+                batch_v_change.add(grad_prev, -weight);
+            }
+
+            // v += batch_v_change / batch_size
+            {
+                VRSGD_TRACE_SCOPE(PHASE_UPDATE);
+                batch_v_change.apply(v, (T)1. / batch_size);
+            }
+
+            if (inner_stop_ratio > 0 && v.norm_sqr() <= stop_norm_sqr) {
+                break;
+            }
+        }
+    }
+
+    report(num_effective_pass, VRSGD_TRACED(PHASE_COST, problem.cost_func(w)));
+
+    return w;
+}
+
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include "lib/utils.hpp"
+#include "lib/sampler.hpp"
+#include "problem/ridge_regression.hpp"
+#include "problem/lasso_regression.hpp"
+
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+namespace VRSGD {
+
+// Regularizer l2 / 2 ||w||^2 + l1 ||w||_1 of a squared-loss problem, as seen
+// by sdca_train. Overload it to run SDCA on other problem types.
+struct SDCARegularizer {
+    double l1;
+    double l2;
+};
+
+template <bool is_sparse>
+inline SDCARegularizer sdca_regularizer(const RidgeRegression<is_sparse>& problem, double) {
+    return {0, problem.get_lambda()};
+}
+
+template <bool is_sparse>
+inline SDCARegularizer sdca_regularizer(const RidgeRegressionProx<is_sparse>& problem, double) {
+    return {0, problem.get_lambda()};
+}
+
+// The L1 penalty alone is not strongly convex, prox-SDCA adds l2_smoothing
+template <bool is_sparse>
+inline SDCARegularizer sdca_regularizer(const LassoRegression<is_sparse>& problem, double l2_smoothing) {
+    return {problem.get_lambda(), l2_smoothing};
+}
+
+/*
+ * Prox-SDCA (Shalev-Shwartz & Zhang) for the squared loss,
+ *   P(w) = 1/n sum_i (x_i w - y_i)^2 / 2 + l2 / 2 ||w||^2 + l1 ||w||_1
+ * with the regularizer taken from the problem, see sdca_regularizer(). Every
+ * step maximizes the dual in one coordinate alpha_i in closed form and
+ * touches only the nonzeros of x_i, the state is one scalar per row instead
+ * of a gradient table:
+ *   v = 1 / (l2 n) sum_i alpha_i x_i,  w = soft_threshold(v, l1 / l2)
+ *
+ * @param l2_smoothing
+ * l2 added to LassoRegression, the result is within l2_smoothing / 2 ||w*||^2
+ * of the lasso optimum. The l2 of the regularizer must be > 0 and the
+ * problem without intercept, otherwise std::invalid_argument is thrown
+ *
+ * @param num_iter
+ * passes over the data
+ *
+ * @param gap_eps
+ * training stops once the duality gap P(w) - D(alpha), an upper bound on
+ * P(w) - P(w*), is <= gap_eps; it is evaluated after every pass
+ *
+ * @param report
+ * receives (pass, P(w)) after every pass, the objective the duality gap
+ * bounds, training stops once it returns false
+ *
+ * @param duality_gap
+ * if not null, receives the final duality gap
+ *
+ * @return the final w
+ */
+
+template<typename T, typename U, bool is_sparse, typename ProblemT, typename SamplerT = Sampler<>>
+DenseVector<T> sdca_train(ProblemT& problem, double l2_smoothing, int num_iter, int w_feature_num, double gap_eps, SamplerT sampler = SamplerT(), const ReportFunc& report = print_progress, double* duality_gap = nullptr) {
+    const auto& data_points = problem.get_data_points();
+    SDCARegularizer reg = sdca_regularizer(problem, l2_smoothing);
+    if (!(reg.l2 > 0)) {
+        throw std::invalid_argument("sdca_train: the l2 regularization must be > 0");
+    }
+    // The dual update has no coordinate for the intercept
+    if (problem.has_intercept()) {
+        throw std::invalid_argument("sdca_train: problems with an intercept are not supported");
+    }
+
+    int data_num = problem.size();
+    double scale = 1. / (reg.l2 * data_num);
+    double threshold = reg.l1 / reg.l2;
+
+    std::vector<T> alpha(data_num);
+    std::vector<T> norm_sqr(data_num);
+    for (int i = 0; i < data_num; i++) {
+        norm_sqr[i] = data_points[i].x.norm_sqr();
+    }
+    DenseVector<T> v(w_feature_num);
+    DenseVector<T> w(w_feature_num);
+    sampler.init(problem);
+
+    double gap = 0;
+    for (int i = 0; i <= num_iter; i++) {
+        // P(w) - D(alpha), with g*(v) = 1/2 ||w||^2 for the soft-thresholded w
+        double primal = 0, dual = 0;
+        for (int k = 0; k < data_num; k++) {
+            double residual = w.dot(data_points[k].x) - data_points[k].y;
+            primal += residual * residual / 2.;
+            dual += alpha[k] * data_points[k].y - alpha[k] * alpha[k] / 2.;
+        }
+        double w_norm_sqr = w.norm_sqr();
+        double w_norm_l1 = 0;
+        for (int j = 0; j < w_feature_num; j++) {
+            w_norm_l1 += std::abs(w[j]);
+        }
+        primal = primal / data_num + reg.l2 / 2. * w_norm_sqr + reg.l1 * w_norm_l1;
+        dual = dual / data_num - reg.l2 / 2. * w_norm_sqr;
+        gap = primal - dual;
+
+        if (!report(i, primal) || gap <= gap_eps || i == num_iter) {
+            break;
+        }
+
+        for (int k = 0; k < data_num; k++) {
+            int row = sampler.next();
+            const auto& x = data_points[row].x;
+
+            double delta = (data_points[row].y - w.dot(x) - alpha[row]) / (1. + norm_sqr[row] * scale);
+            alpha[row] += delta;
+
+            for (auto it = x.begin_feaval(); it != x.end_feaval(); ++it) {
+                const auto& entry = *it;
+                T v_j = v[entry.fea] + delta * scale * entry.val;
+                v[entry.fea] = v_j;
+                w[entry.fea] = reg.l1 > 0 ? prox_l1(v_j, (T)threshold) : v_j;
+            }
+        }
+    }
+
+    if (duality_gap) {
+        *duality_gap = gap;
+    }
+
+    return w;
+}
+
+}
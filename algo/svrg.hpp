@@ -1,6 +1,10 @@
 #pragma once
 
 #include "lib/utils.hpp"
+#include "lib/sampler.hpp"
+#include "lib/sparse_accumulator.hpp"
+#include "lib/trace.hpp"
+#include "lib/step_size.hpp"
 
 #include <vector>
 #include <functional>
@@ -12,65 +16,115 @@ namespace VRSGD {
  * @param w_tidle_opt
  * 0: w_tidle = last w
  * 1: w_tidle = one of the w in the last inner iteration
- * // 2: w_tidle = average of w in the last inner iteration
+ * 2: w_tidle = average of w in the last inner iteration, w restarts from it
+ *
+ * @param sampler
+ * row selection schedule, see lib/sampler.hpp
+ *
+ * @param report
+ * receives (num_effective_pass, cost) every sample_period inner iterations,
+ * training stops once it returns false
+ *
+ * @param step_opt
+ * 0: constant alpha
+ * 1: Barzilai-Borwein, alpha is only used until the second snapshot, see BBStep
+ *
+ * @param w_init
+ * starting point, e.g. the model trained before new rows arrived; empty or of
+ * another size: 0
+ *
+ * @return the final w
  */
 
-template<typename T, typename U, bool is_sparse, typename ProblemT>
-void svrg_train(ProblemT& problem, double alpha, double lambda, int batch_size, int num_iter, int num_inner_iter, int w_feature_num, int w_tidle_opt, int sample_period) {
+template<typename T, typename U, bool is_sparse, typename ProblemT, typename SamplerT = Sampler<>>
+DenseVector<T> svrg_train(ProblemT& problem, double alpha, double lambda, int batch_size, int num_iter, int num_inner_iter, int w_feature_num, int w_tidle_opt, int sample_period, SamplerT sampler = SamplerT(), const ReportFunc& report = print_progress, int step_opt = 0, const DenseVector<T>& w_init = DenseVector<T>()) {
     typedef LabeledPoint<Vector<T, is_sparse>, U> LabeledPoint_;
     typedef Vector<T, is_sparse> Vector_data;
 
-    std::random_device rd;
-    std::mt19937 gen(rd());
-
-    std::uniform_int_distribution<> dis_num_sample(0, problem.size() - 1);
-    std::uniform_int_distribution<> dis_num_inner_iter(0, num_inner_iter - 1);
-
     DenseVector<T> w_tidle(w_feature_num);
-    DenseVector<T> w(w_feature_num);
+    DenseVector<T> w = w_init.get_feature_num() == w_feature_num ? w_init : DenseVector<T>(w_feature_num);
     DenseVector<T> mu_tidle(w_feature_num);
-    DenseVector<T> batch_w_change(w_feature_num);
+    SparseAccumulator<T> batch_w_change(w_feature_num);
+    DenseVector<T> w_sum(w_tidle_opt == 2 ? w_feature_num : 0);
 
     int data_num = problem.size();
     int num_effective_pass = 0;
     int num_inner_iter_ = num_inner_iter;
+    BBStep<T> bb_step(alpha);
+    sampler.init(problem);
 
     for (int i = 0; i < num_iter; i++) {
+        // w_sum is only up to date if the last outer iteration had inner iterations
+        if (w_tidle_opt == 2 && i > 0 && num_inner_iter_ > 0) {
+            w = w_sum / num_inner_iter_;
+        }
         w_tidle = w;
-        
-        mu_tidle.set_zero();
-        for (int i = 0; i < data_num; i++) {
-            mu_tidle += problem.grad_func(w_tidle, i) / data_num;
+
+        {
+            // Phases are timed when built with -DVRSGD_TRACE, see lib/trace.hpp
+            VRSGD_TRACE_SCOPE(PHASE_FULL_GRAD);
+            mu_tidle.set_zero();
+            for (int i = 0; i < data_num; i++) {
+                ArenaScope scratch;
+                mu_tidle += problem.grad_func(w_tidle, i) / data_num;
+            }
+        }
+
+        if (step_opt == 1) {
+            alpha = bb_step.next(w_tidle, mu_tidle, num_inner_iter);
         }
 
         if (w_tidle_opt == 1) {
-            num_inner_iter_ = dis_num_inner_iter(gen);
+            num_inner_iter_ = bounded_rand(sampler.get_gen(), num_inner_iter);
         }
 
         for (int j = 0; j < num_inner_iter_; j++) {
-            if (num_effective_pass % sample_period == 0) {
-                printf("%d %.15f\n", num_effective_pass, problem.cost_func(w));
+            // The temporaries of the iteration live in the arena, see lib/allocator.hpp
+            ArenaScope scratch;
+
+            if (num_effective_pass % sample_period == 0 && !report(num_effective_pass, VRSGD_TRACED(PHASE_COST, problem.cost_func(w)))) {
+                return w;
             }
 
-            batch_w_change.set_zero();
+            batch_w_change.clear();
             for (int k = 0; k < batch_size; k++) {
-                int rand_row = dis_num_sample(gen);
+                int rand_row = sampler.next();
 
-                auto grad = problem.grad_func(w, rand_row);
-                auto grad_snapshot = problem.grad_func(w_tidle, rand_row);
+                auto grad = VRSGD_TRACED(PHASE_GRAD, problem.grad_func(w, rand_row));
+                auto grad_snapshot = VRSGD_TRACED(PHASE_GRAD, problem.grad_func(w_tidle, rand_row));
 
-                batch_w_change -= alpha * (grad - (grad_snapshot - mu_tidle));
+                VRSGD_TRACE_SCOPE(PHASE_UPDATE);
+                T weight = sampler.weight(rand_row);
+                batch_w_change.add(grad, weight);
+                batch_w_change.add(grad_snapshot, -weight);
             }
 
-            // TODO: may hurt performance by not using +=?
-            w = problem.prox_func(w + batch_w_change / batch_size, alpha, lambda);
-            //w += batch_w_change / (double)batch_size;
+            // w = prox(w - alpha * (batch_w_change / batch_size + mu_tidle))
+            {
+                VRSGD_TRACE_SCOPE(PHASE_UPDATE);
+                w -= mu_tidle * (T)alpha;
+                batch_w_change.apply(w, -alpha / batch_size);
+            }
+            w = VRSGD_TRACED(PHASE_PROX, problem.prox_func(w, alpha, lambda));
+
+            if (w_tidle_opt == 2) {
+                if (j == 0) {
+                    w_sum = w;
+                } else {
+                    w_sum += w;
+                }
+            }
 
             num_effective_pass++;
         }
     }
 
-    printf("%d %.15lf\n", num_effective_pass, problem.cost_func(w));
+    if (w_tidle_opt == 2 && num_iter > 0 && num_inner_iter_ > 0) {
+        w = w_sum / num_inner_iter_;
+    }
+    report(num_effective_pass, VRSGD_TRACED(PHASE_COST, problem.cost_func(w)));
+
+    return w;
 }
 
 }
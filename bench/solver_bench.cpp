@@ -0,0 +1,521 @@
+// Throughput and convergence benchmark for the solvers in algo/.
+//
+// Every (dataset, problem, solver, threads) combination is run once and
+// reported as a JSON object per line on stdout, e.g.
+//
+//   ./solver_bench --datasets synthetic:100000:1000:0.01,libsvm:./datasets/a9a:123 --problems ridge,lasso,logistic --solvers saga,svrg,katyusha,sdca --threads 1,4 --epochs 10
+//
+// logistic trains on the sign of the labels, sdca skips it.
+//
+// With threads > 1 that many independent runs (different seeds) share the
+// machine, samples_per_sec is their aggregate. The objective is evaluated
+// every epoch but its cost is excluded from the timings. epochs_to_eps
+// counts gradient evaluations divided by n up to the first objective within
+// eps of f_star, which compares solvers independently of their speed per
+// iteration. f_star is the optimum of the objective the solver minimizes:
+// for sdca on lasso it includes l2_smoothing / 2 ||w||^2.
+//
+// Built with -DVRSGD_COUNTERS, each line also carries the Vector operation
+// counters of lib/counters.hpp averaged per solver iteration.
+
+#include <lib/vector.hpp>
+#include <lib/utils.hpp>
+#include <lib/synthetic.hpp>
+#include <algo/saga.hpp>
+#include <algo/svrg.hpp>
+#include <algo/loopless_svrg.hpp>
+#include <algo/sarah.hpp>
+#include <algo/katyusha.hpp>
+#include <algo/sdca.hpp>
+#include <problem/ridge_regression.hpp>
+#include <problem/lasso_regression.hpp>
+#include <problem/logistic_regression.hpp>
+
+#include <sys/resource.h>
+
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+static std::atomic<long long> num_alloc(0);
+static std::atomic<long long> alloc_bytes(0);
+
+// Every replaceable allocation function is counted and goes to malloc, so
+// that each delete form frees what its matching new form returned
+static void* counted_alloc(std::size_t size, std::size_t align = 0) {
+    num_alloc.fetch_add(1, std::memory_order_relaxed);
+    alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+    void* p = nullptr;
+    if (align <= alignof(std::max_align_t)) {
+        p = std::malloc(size ? size : 1);
+    } else if (posix_memalign(&p, align, size ? size : 1) != 0) {
+        p = nullptr;
+    }
+    return p;
+}
+
+static void* counted_new(std::size_t size, std::size_t align = 0) {
+    if (void* p = counted_alloc(size, align)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size) { return counted_new(size); }
+void* operator new[](std::size_t size) { return counted_new(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return counted_alloc(size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return counted_alloc(size); }
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+
+#ifdef __cpp_aligned_new
+void* operator new(std::size_t size, std::align_val_t align) { return counted_new(size, (std::size_t)align); }
+void* operator new[](std::size_t size, std::align_val_t align) { return counted_new(size, (std::size_t)align); }
+void* operator new(std::size_t size, std::align_val_t align, const std::nothrow_t&) noexcept {
+    return counted_alloc(size, (std::size_t)align);
+}
+void* operator new[](std::size_t size, std::align_val_t align, const std::nothrow_t&) noexcept {
+    return counted_alloc(size, (std::size_t)align);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { std::free(p); }
+#endif
+
+typedef std::chrono::steady_clock Clock;
+typedef VRSGD::LabeledPoint<VRSGD::Vector<double, true>, double> LabeledPoint_;
+
+static double seconds_since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static long peak_rss_kb() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+// s as the contents of a JSON string
+static std::string json_escape(const std::string& s) {
+    std::string res;
+    for (unsigned char c : s) {
+        if (c == '"' || c == '\\') {
+            res += '\\';
+            res += c;
+        } else if (c < 0x20) {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", c);
+            res += buf;
+        } else {
+            res += c;
+        }
+    }
+    return res;
+}
+
+// The solvers count iterations in int, longer budgets are cut to INT_MAX
+static int iter_budget(long long num_iter) {
+    if (num_iter > INT_MAX) {
+        fprintf(stderr, "%lld iterations exceed INT_MAX, running %d\n", num_iter, INT_MAX);
+        return INT_MAX;
+    }
+    return (int)num_iter;
+}
+
+static std::vector<std::string> split(const std::string& s, char sep) {
+    std::vector<std::string> res;
+    std::stringstream ss(s);
+    std::string item;
+    while (std::getline(ss, item, sep)) {
+        res.push_back(item);
+    }
+    return res;
+}
+
+// Forwards to ProblemT and accumulates the time spent in cost_func, so the
+// objective trace does not count towards solver throughput or op counters.
+// Also counts the grad_func calls.
+template <typename ProblemT>
+class TimedProblem {
+   public:
+    TimedProblem(ProblemT& problem, double* cost_time, long long* num_grad)
+        : problem(&problem), cost_time(cost_time), num_grad(num_grad) {}
+
+    double cost_func(const VRSGD::DenseVector<double>& w) {
+#ifdef VRSGD_COUNTERS
+        VRSGD::OpCounters saved = VRSGD::op_counters();
+#endif
+        auto start = Clock::now();
+        double res = problem->cost_func(w);
+        *cost_time += seconds_since(start);
+#ifdef VRSGD_COUNTERS
+        VRSGD::op_counters() = saved;
+#endif
+        return res;
+    }
+
+    inline auto grad_func(const VRSGD::DenseVector<double>& w, int idx) -> decltype(std::declval<ProblemT>().grad_func(w, idx)) {
+        ++*num_grad;
+        return problem->grad_func(w, idx);
+    }
+
+    inline VRSGD::DenseVector<double> prox_func(const VRSGD::DenseVector<double>& y, double alpha, double lambda) {
+        return problem->prox_func(y, alpha, lambda);
+    }
+
+    inline double smoothness(int idx) { return problem->smoothness(idx); }
+
+    inline bool has_intercept() const { return problem->has_intercept(); }
+
+    int size() { return problem->size(); }
+
+    inline const ProblemT& get_problem() const { return *problem; }
+
+    inline auto get_data_points() const -> decltype(std::declval<ProblemT>().get_data_points()) {
+        return problem->get_data_points();
+    }
+
+   private:
+    ProblemT* problem;
+    double* cost_time;
+    long long* num_grad;
+};
+
+template <typename ProblemT>
+VRSGD::SDCARegularizer sdca_regularizer(const TimedProblem<ProblemT>& problem, double l2_smoothing) {
+    return VRSGD::sdca_regularizer(problem.get_problem(), l2_smoothing);
+}
+
+struct Config {
+    int epochs = 10;
+    int ref_epochs = 30;
+    int batch_size = 1;
+    int sample_opt = 0;
+    double alpha = 0;
+    double lambda = 1e-4;
+    double sigma = 0;       // strong convexity of the problem, for katyusha
+    double l2_smoothing = 1e-5; // sdca with lasso
+    double eps = 1e-4;
+    uint64_t seed = 1;
+};
+
+struct Trace {
+    double cost_time = 0;
+    double time_to_eps = -1;
+    double epochs_to_eps = -1;
+    double final_cost = 0;
+    double run_time = 0;
+    long long num_grad = 0;
+    long long num_iter = 0;
+#ifdef VRSGD_COUNTERS
+    VRSGD::OpCounters counters;
+#endif
+};
+
+// sdca only solves the squared-loss problems, see algo/sdca.hpp
+template <typename ProblemT>
+struct HasSDCA : std::true_type {};
+
+template <bool is_sparse>
+struct HasSDCA<VRSGD::LogisticRegression<is_sparse>> : std::false_type {};
+
+template <typename ProblemT>
+void run_sdca(TimedProblem<ProblemT>& timed, const Config& config, int w_feature_num, int epochs, uint64_t seed,
+              const VRSGD::ReportFunc& report, std::true_type) {
+    // One pass per epoch, the duality gap is only used for stopping
+    VRSGD::sdca_train<double, double, true>(timed, config.l2_smoothing, epochs, w_feature_num, 0,
+                                            VRSGD::Sampler<>(config.sample_opt, seed), report);
+}
+
+template <typename ProblemT>
+void run_sdca(TimedProblem<ProblemT>&, const Config&, int, int, uint64_t, const VRSGD::ReportFunc&, std::false_type) {}
+
+// The objective sdca minimizes on a lasso, ProblemT plus l2 / 2 ||w||^2
+template <typename ProblemT>
+class SmoothedProblem {
+   public:
+    SmoothedProblem(ProblemT& problem, double l2) : problem(&problem), l2(l2) {}
+
+    double cost_func(const VRSGD::DenseVector<double>& w) { return problem->cost_func(w) + l2 / 2. * w.norm_sqr(); }
+
+    VRSGD::DenseVector<double> grad_func(const VRSGD::DenseVector<double>& w, int idx) {
+        VRSGD::DenseVector<double> res = w * l2;
+        res += problem->grad_func(w, idx);
+        return res;
+    }
+
+    inline VRSGD::DenseVector<double> prox_func(const VRSGD::DenseVector<double>& y, double alpha, double lambda) {
+        return problem->prox_func(y, alpha, lambda);
+    }
+
+    inline double smoothness(int idx) { return problem->smoothness(idx) + l2; }
+
+    inline bool has_intercept() const { return problem->has_intercept(); }
+
+    int size() { return problem->size(); }
+
+    inline auto get_data_points() const -> decltype(std::declval<ProblemT>().get_data_points()) {
+        return problem->get_data_points();
+    }
+
+   private:
+    ProblemT* problem;
+    double l2;
+};
+
+template <typename ProblemT>
+struct HasSDCA<SmoothedProblem<ProblemT>> : std::false_type {};
+
+// Runs one solver to completion and returns its timings; f_star < 0 disables
+// the time-to-epsilon bookkeeping
+template <typename ProblemT>
+Trace run_solver(ProblemT& problem, const std::string& solver, const Config& config, int w_feature_num, int epochs,
+                 double f_star, uint64_t seed) {
+    Trace trace;
+    TimedProblem<ProblemT> timed(problem, &trace.cost_time, &trace.num_grad);
+    int data_num = problem.size();
+
+#ifdef VRSGD_COUNTERS
+    VRSGD::op_counters().reset();
+#endif
+    auto start = Clock::now();
+    auto report = [&](int, double cost) {
+        trace.final_cost = cost;
+        if (f_star >= 0 && trace.time_to_eps < 0 && cost - f_star <= config.eps) {
+            trace.time_to_eps = seconds_since(start) - trace.cost_time;
+            trace.epochs_to_eps = (double)trace.num_grad / data_num;
+        }
+        return true;
+    };
+
+    if (solver == "saga") {
+        int num_iter = iter_budget((long long)epochs * data_num / config.batch_size);
+        VRSGD::saga_train<double, double, true>(timed, config.alpha, config.lambda, config.batch_size, num_iter,
+                                                w_feature_num, data_num / config.batch_size,
+                                                VRSGD::Sampler<>(config.sample_opt, seed), report);
+        trace.num_iter = num_iter;
+    } else if (solver == "sdca") {
+        run_sdca(timed, config, w_feature_num, epochs, seed,
+                 [&](int pass, double cost) {
+                     trace.num_grad = (long long)pass * data_num;
+                     return report(pass, cost);
+                 },
+                 HasSDCA<ProblemT>());
+        trace.num_iter = (long long)epochs * data_num;
+    } else if (solver == "loopless_svrg") {
+        // Two gradients per sample plus a full pass per epoch in expectation
+        int num_iter = iter_budget((long long)epochs * data_num / (3 * config.batch_size));
+        VRSGD::loopless_svrg_train<double, double, true>(timed, config.alpha, config.lambda, config.batch_size, num_iter,
+                                                         w_feature_num, 0, data_num / config.batch_size,
+                                                         VRSGD::Sampler<>(config.sample_opt, seed), report);
+        trace.num_iter = num_iter;
+    } else if (solver == "sarah" || solver == "katyusha") {
+        // Same budget as svrg below
+        int num_outer = std::max(1, epochs / 3);
+        int num_inner = data_num / config.batch_size;
+        if (solver == "sarah") {
+            VRSGD::sarah_train<double, double, true>(timed, config.alpha, config.lambda, config.batch_size, num_outer,
+                                                     num_inner, w_feature_num, 0, num_inner,
+                                                     VRSGD::Sampler<>(config.sample_opt, seed), report);
+        } else {
+            VRSGD::katyusha_train<double, double, true>(timed, 1. / (3. * config.alpha), config.sigma, config.lambda,
+                                                        config.batch_size, num_outer, num_inner, w_feature_num, num_inner,
+                                                        VRSGD::Sampler<>(config.sample_opt, seed), report);
+        }
+        trace.num_iter = (long long)num_outer * num_inner;
+    } else {
+        // One outer iteration is a full pass for the snapshot plus two inner passes
+        int num_outer = std::max(1, epochs / 3);
+        int num_inner = data_num / config.batch_size;
+        VRSGD::svrg_train<double, double, true>(timed, config.alpha, config.lambda, config.batch_size, num_outer,
+                                                num_inner, w_feature_num, 0, num_inner,
+                                                VRSGD::Sampler<>(config.sample_opt, seed), report);
+        trace.num_iter = (long long)num_outer * num_inner;
+    }
+
+    trace.run_time = seconds_since(start) - trace.cost_time;
+#ifdef VRSGD_COUNTERS
+    trace.counters = VRSGD::op_counters();
+#endif
+    return trace;
+}
+
+// Optimum of the objective sdca minimizes, which differs from f_star by the
+// l2_smoothing it adds to a lasso
+template <typename ProblemT>
+double sdca_f_star(ProblemT& problem, const Config& config, int w_feature_num, double f_star, std::true_type) {
+    VRSGD::SDCARegularizer reg = VRSGD::sdca_regularizer(problem, config.l2_smoothing);
+    if (reg.l1 == 0) {
+        return f_star;
+    }
+    SmoothedProblem<ProblemT> smoothed(problem, reg.l2);
+    return run_solver(smoothed, "svrg", config, w_feature_num, config.ref_epochs, -1, config.seed).final_cost;
+}
+
+template <typename ProblemT>
+double sdca_f_star(ProblemT&, const Config&, int, double f_star, std::false_type) {
+    return f_star;
+}
+
+template <typename ProblemT>
+void bench_problem(ProblemT& problem, const std::string& dataset, const std::string& problem_name,
+                   const std::vector<std::string>& solvers, const std::vector<int>& threads, Config config,
+                   int w_feature_num) {
+    if (config.alpha <= 0) {
+        config.alpha = 1. / (3. * VRSGD::max_smoothness(problem));
+    }
+
+    // Reference optimum for the suboptimality measure
+    double f_star = run_solver(problem, "svrg", config, w_feature_num, config.ref_epochs, -1, config.seed).final_cost;
+
+    for (const auto& solver : solvers) {
+        if (solver == "sdca" && !HasSDCA<ProblemT>::value) {
+            fprintf(stderr, "sdca does not support %s, skipped\n", problem_name.c_str());
+            continue;
+        }
+        double solver_f_star = solver == "sdca" ? sdca_f_star(problem, config, w_feature_num, f_star, HasSDCA<ProblemT>())
+                                                : f_star;
+        for (int num_thread : threads) {
+            std::vector<Trace> traces(num_thread);
+
+            long long alloc_before = num_alloc.load();
+            long long alloc_bytes_before = alloc_bytes.load();
+            auto start = Clock::now();
+
+            std::vector<std::thread> workers;
+            for (int t = 0; t < num_thread; t++) {
+                workers.emplace_back([&, t]() {
+                    traces[t] = run_solver(problem, solver, config, w_feature_num, config.epochs, solver_f_star,
+                                           config.seed + t);
+                });
+            }
+            for (auto& worker : workers) {
+                worker.join();
+            }
+
+            double wall_time = seconds_since(start);
+            double run_time = 0;
+            long long num_grad = 0;
+            for (const auto& trace : traces) {
+                run_time = std::max(run_time, trace.run_time);
+                num_grad += trace.num_grad;
+            }
+
+            printf("{\"dataset\": \"%s\", \"problem\": \"%s\", \"solver\": \"%s\", \"threads\": %d, "
+                   "\"n\": %d, \"d\": %d, \"alpha\": %g, \"lambda\": %g, \"epochs\": %d, "
+                   "\"samples_per_sec\": %.1f, \"time_to_eps\": %.6f, \"epochs_to_eps\": %.3f, \"eps\": %g, \"f_star\": %.15f, "
+                   "\"final_cost\": %.15f, \"run_time\": %.6f, \"wall_time\": %.6f, "
+                   "\"peak_rss_kb\": %ld, \"allocs\": %lld, \"alloc_bytes\": %lld",
+                   json_escape(dataset).c_str(), json_escape(problem_name).c_str(), json_escape(solver).c_str(),
+                   num_thread, problem.size(), w_feature_num,
+                   config.alpha, config.lambda, config.epochs, num_grad / run_time, traces[0].time_to_eps,
+                   traces[0].epochs_to_eps, config.eps,
+                   solver_f_star, traces[0].final_cost, run_time, wall_time, peak_rss_kb(), num_alloc.load() - alloc_before,
+                   alloc_bytes.load() - alloc_bytes_before);
+#ifdef VRSGD_COUNTERS
+            printf(", \"ops_per_iter\": ");
+            traces[0].counters.print(stdout, traces[0].num_iter);
+#endif
+            printf("}\n");
+            fflush(stdout);
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    std::map<std::string, std::string> args = {
+        {"datasets", "synthetic:20000:1000:0.01"},
+        {"problems", "ridge,lasso,logistic"},
+        {"solvers", "saga,svrg"},
+        {"threads", "1"},
+    };
+    Config config;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string key = argv[i];
+        if (key.compare(0, 2, "--") != 0) {
+            fprintf(stderr, "unexpected argument %s\n", argv[i]);
+            return 1;
+        }
+        args[key.substr(2)] = argv[i + 1];
+    }
+
+    if (args.count("epochs")) config.epochs = std::stoi(args["epochs"]);
+    if (args.count("ref_epochs")) config.ref_epochs = std::stoi(args["ref_epochs"]);
+    if (args.count("batch_size")) config.batch_size = std::stoi(args["batch_size"]);
+    if (args.count("sample_opt")) config.sample_opt = std::stoi(args["sample_opt"]);
+    if (args.count("alpha")) config.alpha = std::stod(args["alpha"]);
+    if (args.count("lambda")) config.lambda = std::stod(args["lambda"]);
+    if (args.count("eps")) config.eps = std::stod(args["eps"]);
+    if (args.count("seed")) config.seed = std::stoull(args["seed"]);
+    if (args.count("l2_smoothing")) config.l2_smoothing = std::stod(args["l2_smoothing"]);
+
+    std::vector<int> threads;
+    for (const auto& t : split(args["threads"], ',')) {
+        threads.push_back(std::stoi(t));
+    }
+
+    for (const auto& dataset : split(args["datasets"], ',')) {
+        // synthetic:n:d:density or libsvm:path:feature_num
+        auto spec = split(dataset, ':');
+        std::vector<LabeledPoint_> data_points;
+        int feature_num;
+
+        if (spec[0] == "synthetic" && spec.size() == 4) {
+            feature_num = std::stoi(spec[2]);
+            VRSGD::make_synthetic(data_points, std::stoi(spec[1]), feature_num, std::stod(spec[3]), 0.1, 0, config.seed);
+        } else if (spec[0] == "libsvm" && spec.size() == 3) {
+            feature_num = std::stoi(spec[2]);
+            VRSGD::read_libsvm(data_points, spec[1], feature_num);
+            for (auto& data_point : data_points) {
+                data_point.x /= data_point.x.norm();
+            }
+        } else {
+            fprintf(stderr, "bad dataset spec %s\n", dataset.c_str());
+            return 1;
+        }
+
+        for (const auto& problem_name : split(args["problems"], ',')) {
+            if (problem_name == "ridge") {
+                VRSGD::RidgeRegression<true> problem(data_points, config.lambda);
+                Config ridge_config = config;
+                ridge_config.sigma = config.lambda;
+                bench_problem(problem, dataset, problem_name, split(args["solvers"], ','), threads, ridge_config, feature_num);
+            } else if (problem_name == "lasso") {
+                VRSGD::LassoRegression<true> problem(data_points, config.lambda);
+                bench_problem(problem, dataset, problem_name, split(args["solvers"], ','), threads, config, feature_num);
+            } else if (problem_name == "logistic") {
+                // Labels in {0, 1} from the sign of y, w has a trailing intercept
+                std::vector<LabeledPoint_> class_points = data_points;
+                for (auto& data_point : class_points) {
+                    data_point.y = data_point.y > 0 ? 1 : 0;
+                }
+                VRSGD::LogisticRegression<true> problem(class_points, config.lambda);
+                bench_problem(problem, dataset, problem_name, split(args["solvers"], ','), threads, config,
+                              feature_num + 1);
+            } else {
+                fprintf(stderr, "unknown problem %s\n", problem_name.c_str());
+                return 1;
+            }
+        }
+    }
+}
@@ -0,0 +1,142 @@
+// Microbenchmarks for the Vector kernels in lib/vector.hpp and lib/prox.hpp.
+//
+// Rows are synthetic but shaped like the bundled datasets (dimension and
+// average nonzeros per row). Each kernel prints one JSON object per line with
+// its time per call and the effective memory bandwidth, e.g.
+//
+//   ./vector_bench --shapes a9a,rcv1 --min_time 0.2
+
+#include <lib/vector.hpp>
+#include <lib/prox.hpp>
+#include <lib/synthetic.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+struct Shape {
+    const char* name;
+    int feature_num;
+    double density;
+};
+
+// Dimensions and densities of the datasets the drivers use
+static const Shape shapes[] = {
+    {"housing_scale", 14, 1.},
+    {"covtype", 54, 0.22},
+    {"a9a", 123, 0.113},
+    {"rcv1", 47236, 0.0016},
+};
+
+static volatile double sink;
+
+// Calls op(i) for i = 0, 1, ... until min_time has passed and returns the
+// average nanoseconds per call
+static double time_op(const std::function<void(int)>& op, double min_time) {
+    long long num_call = 0;
+    auto start = Clock::now();
+    double elapsed = 0;
+    for (int batch = 64; elapsed < min_time; batch *= 2) {
+        for (int i = 0; i < batch; i++) {
+            op(num_call + i);
+        }
+        num_call += batch;
+        elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    }
+    return elapsed * 1e9 / num_call;
+}
+
+static void report(const Shape& shape, double nnz, const char* op, double ns, double bytes) {
+    printf("{\"shape\": \"%s\", \"d\": %d, \"nnz\": %.1f, \"op\": \"%s\", \"ns_per_op\": %.2f, \"gb_per_s\": %.3f}\n",
+           shape.name, shape.feature_num, nnz, op, ns, bytes / ns);
+    fflush(stdout);
+}
+
+static void bench_shape(const Shape& shape, int num_row, double min_time) {
+    typedef VRSGD::LabeledPoint<VRSGD::SparseVector<double>, double> SparsePoint;
+
+    std::vector<SparsePoint> sparse_points;
+    VRSGD::make_synthetic(sparse_points, num_row, shape.feature_num, shape.density, 0., 0, 1);
+
+    std::vector<VRSGD::DenseVector<double>> dense_rows;
+    double nnz = 0;
+    for (const auto& point : sparse_points) {
+        dense_rows.emplace_back(point.x);
+        nnz += point.x.get_nnz();
+    }
+    nnz /= num_row;
+
+    VRSGD::DenseVector<double> w(shape.feature_num, 0.01);
+    int mask = num_row - 1;
+    double d = shape.feature_num * sizeof(double);
+    double s = nnz * sizeof(VRSGD::FeaValPair<double>);
+
+    auto row = [&](int i) -> const VRSGD::SparseVector<double>& { return sparse_points[i & mask].x; };
+    auto dense_row = [&](int i) -> const VRSGD::DenseVector<double>& { return dense_rows[i & mask]; };
+
+    report(shape, nnz, "dot_dense", time_op([&](int i) { sink = w.dot(dense_row(i)); }, min_time), 2 * d);
+    report(shape, nnz, "dot_sparse", time_op([&](int i) { sink = w.dot(row(i)); }, min_time), s + nnz * sizeof(double));
+
+    report(shape, nnz, "axpy_dense", time_op([&](int i) { w += dense_row(i); }, min_time), 3 * d);
+    report(shape, nnz, "axpy_sparse", time_op([&](int i) { w += row(i); }, min_time), s + 2 * nnz * sizeof(double));
+    w = VRSGD::DenseVector<double>(shape.feature_num, 0.01);
+
+    report(shape, nnz, "scale_dense", time_op([&](int i) { sink = (dense_row(i) * 0.5)[0]; }, min_time), 2 * d);
+    report(shape, nnz, "scale_sparse", time_op([&](int i) { sink = (row(i) * 0.5).get_nnz(); }, min_time), 2 * s);
+
+    report(shape, nnz, "intcpt_dense",
+           time_op([&](int i) { sink = dense_row(i).scalar_multiple_with_intcpt(0.5)[0]; }, min_time), 2 * d);
+    report(shape, nnz, "intcpt_sparse",
+           time_op([&](int i) { sink = row(i).scalar_multiple_with_intcpt(0.5).get_nnz(); }, min_time), 2 * s);
+
+    report(shape, nnz, "feaval_dense", time_op([&](int i) {
+               double res = 0;
+               const auto& x = dense_row(i);
+               for (auto it = x.begin_feaval(); it != x.end_feaval(); ++it) {
+                   const auto&& entry = *it;
+                   res += entry.fea * entry.val;
+               }
+               sink = res;
+           }, min_time), d);
+    report(shape, nnz, "feaval_sparse", time_op([&](int i) {
+               double res = 0;
+               const auto& x = row(i);
+               for (auto it = x.begin_feaval(); it != x.end_feaval(); ++it) {
+                   res += it->fea * it->val;
+               }
+               sink = res;
+           }, min_time), s);
+
+    report(shape, nnz, "prox_l1_dense", time_op([&](int) { sink = VRSGD::prox_l1(w, 0.1, 1e-4)[0]; }, min_time), 2 * d);
+    report(shape, nnz, "prox_l2_dense", time_op([&](int) { sink = VRSGD::prox_l2(w, 0.1, 1e-4)[0]; }, min_time), 2 * d);
+}
+
+int main(int argc, char** argv) {
+    std::map<std::string, std::string> args = {{"shapes", "housing_scale,covtype,a9a,rcv1"}, {"min_time", "0.1"}};
+    for (int i = 1; i + 1 < argc; i += 2) {
+        args[std::string(argv[i]).substr(2)] = argv[i + 1];
+    }
+
+    double min_time = std::stod(args["min_time"]);
+    std::stringstream ss(args["shapes"]);
+    std::string name;
+    while (std::getline(ss, name, ',')) {
+        bool found = false;
+        for (const auto& shape : shapes) {
+            if (name == shape.name) {
+                bench_shape(shape, 1024, min_time);
+                found = true;
+            }
+        }
+        if (!found) {
+            fprintf(stderr, "unknown shape %s\n", name.c_str());
+            return 1;
+        }
+    }
+}
@@ -0,0 +1,266 @@
+// Data-parallel SVRG over several processes, see algo/dist_svrg.hpp:
+//
+//   ./dist_svrg --data ./datasets/covtype.binary --workers 4
+//   ./dist_svrg --data ./shards/part-%d --workers 4 --rank 2 --host 10.0.0.1 --seed 7
+//
+// Without --rank all workers are started on this machine, as forked
+// processes connected over localhost sockets (--transport socket) or as
+// threads of this process (--transport local). With --rank only that worker
+// is run and it connects to rank 0 at host:port, which is how a job whose
+// data is already sharded across nodes is started, one process per node.
+// Rank 0 listens on host as well, so every rank gets the address of the node
+// of rank 0.
+//
+// If data contains %d, every worker reads the file with %d replaced by its
+// rank. Otherwise every worker reads the whole file and keeps the rows
+// i % workers == rank. Rank 0 prints the progress and writes the model.
+
+#include <lib/vector.hpp>
+#include <lib/utils.hpp>
+#include <lib/sampler.hpp>
+#include <lib/synthetic.hpp>
+#include <lib/model.hpp>
+#include <lib/transport.hpp>
+#include <algo/dist_svrg.hpp>
+#include <problem/ridge_regression.hpp>
+#include <problem/lasso_regression.hpp>
+#include <problem/logistic_regression.hpp>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef VRSGD::LabeledPoint<VRSGD::Vector<double, true>, double> LabeledPoint_;
+
+typedef std::map<std::string, std::string> Args;
+
+// The transports only sum, so a maximum is taken over one slot per rank
+template <typename TransportT>
+double max_over_workers(TransportT& transport, double value) {
+    std::vector<double> slots(transport.size());
+    slots[transport.rank()] = value;
+    transport.allreduce_sum(slots.data(), slots.size());
+    return *std::max_element(slots.begin(), slots.end());
+}
+
+bool load_shard(std::vector<LabeledPoint_>& data_points, int& feature_num, Args& args, int rank, int num_worker) {
+    std::string data = args["data"];
+    bool sharded = data.find("%d") != std::string::npos;
+    if (sharded) {
+        data.replace(data.find("%d"), 2, std::to_string(rank));
+    }
+
+    std::vector<LabeledPoint_> all;
+    if (data.compare(0, 10, "synthetic:") == 0) {
+        int data_num;
+        double density;
+        if (sscanf(data.c_str(), "synthetic:%d:%d:%lf", &data_num, &feature_num, &density) != 3) {
+            fprintf(stderr, "expected synthetic:n:d:density, got %s\n", data.c_str());
+            return false;
+        }
+        VRSGD::make_synthetic(all, data_num, feature_num, density, 0.1, args["problem"] == "logistic" ? 2 : 0,
+                              std::stoull(args["seed"]));
+    } else if (args["format"] == "binary") {
+        feature_num = VRSGD::read_binary(all, data);
+        if (feature_num < 0) {
+            fprintf(stderr, "rank %d: %s is not in the binary format or is corrupt\n", rank, data.c_str());
+            return false;
+        }
+    } else {
+        feature_num = VRSGD::read_libsvm(all, data, std::stoi(args["feature_num"]));
+    }
+    if (all.empty()) {
+        fprintf(stderr, "rank %d: no data in %s\n", rank, data.c_str());
+        return false;
+    }
+
+    for (std::size_t i = 0; i < all.size(); i++) {
+        if (sharded || (int)(i % num_worker) == rank) {
+            data_points.push_back(std::move(all[i]));
+        }
+    }
+    return true;
+}
+
+template <typename ProblemT, typename TransportT>
+VRSGD::DenseVector<double> train(ProblemT& problem, TransportT& transport, Args& args, int w_feature_num) {
+    int data_num = problem.size();
+    int batch_size = std::stoi(args["batch_size"]);
+
+    double alpha = std::stod(args["alpha"]);
+    if (alpha <= 0) {
+        alpha = 1. / (3. * max_over_workers(transport, VRSGD::max_smoothness(problem)));
+        if (transport.rank() == 0) {
+            printf("alpha: %.15lf\n", alpha);
+        }
+    }
+
+    uint64_t seed = std::stoull(args["seed"]);
+    if (seed == 0) {
+        seed = std::random_device()();
+    }
+    // Same seed, one stream per rank
+    VRSGD::Sampler<> sampler(std::stoi(args["sample_opt"]), seed, 1024, transport.rank());
+
+    int num_inner_iter = std::stoi(args["num_inner_iter"]) > 0 ? std::stoi(args["num_inner_iter"]) : 2 * data_num / batch_size;
+    num_inner_iter = std::max<int>(max_over_workers(transport, num_inner_iter), 1);
+    int sample_period = std::stoi(args["sample_period"]) > 0 ? std::stoi(args["sample_period"]) : num_inner_iter;
+
+    return VRSGD::dist_svrg_train<double, double, true>(problem, transport, alpha, std::stod(args["lambda"]), batch_size,
+                                                        std::stoi(args["epochs"]), num_inner_iter, w_feature_num,
+                                                        std::stoi(args["avg_period"]), sample_period, sampler);
+}
+
+template <typename TransportT>
+int run_worker(TransportT& transport, Args args) {
+    int rank = transport.rank();
+
+    std::vector<LabeledPoint_> data_points;
+    int feature_num = 0;
+    double ok = load_shard(data_points, feature_num, args, rank, transport.size());
+    // Every rank has to take part in the collectives below, so a failed load
+    // is agreed on first
+    transport.allreduce_sum(&ok, 1);
+    if (ok != transport.size()) {
+        return 1;
+    }
+    feature_num = max_over_workers(transport, feature_num);
+    for (auto& data_point : data_points) {
+        data_point.x.resize(feature_num);
+    }
+    if (rank == 0) {
+        printf("workers: %d feature_num: %d\n", transport.size(), feature_num);
+    }
+
+    VRSGD::Model model;
+    model.problem = args["problem"];
+    model.feature_num = feature_num;
+
+    double lambda = std::stod(args["lambda"]);
+    if (args["problem"] == "ridge") {
+        VRSGD::RidgeRegression<true> problem(data_points, lambda);
+        model.w = train(problem, transport, args, feature_num);
+    } else if (args["problem"] == "ridge_prox") {
+        VRSGD::RidgeRegressionProx<true> problem(data_points, lambda);
+        model.w = train(problem, transport, args, feature_num);
+    } else if (args["problem"] == "lasso") {
+        VRSGD::LassoRegression<true> problem(data_points, lambda);
+        model.w = train(problem, transport, args, feature_num);
+    } else {
+        VRSGD::LogisticRegression<true> problem(data_points, lambda);
+        model.w = train(problem, transport, args, feature_num + 1);
+    }
+
+    if (rank == 0 && args["model"] != "" && !VRSGD::save_model(model, args["model"])) {
+        fprintf(stderr, "cannot write model %s\n", args["model"].c_str());
+        return 1;
+    }
+    return 0;
+}
+
+int run_socket_worker(int rank, Args& args) {
+    try {
+        VRSGD::SocketTransport transport(rank, std::stoi(args["workers"]), std::stoi(args["port"]), args["host"]);
+        return run_worker(transport, args);
+    } catch (const std::runtime_error& e) {
+        fprintf(stderr, "rank %d: %s\n", rank, e.what());
+        return 1;
+    }
+}
+
+int main(int argc, char** argv) {
+    Args args = {
+        {"problem", "ridge"},       // ridge, ridge_prox, lasso or logistic
+        {"data", ""},               // %d is replaced by the rank
+        {"format", "libsvm"},       // libsvm or binary
+        {"feature_num", "0"},       // 0: largest feature index over all shards
+        {"workers", "2"},
+        {"rank", ""},               // run only this worker
+        {"transport", "socket"},    // socket or local
+        {"host", "127.0.0.1"},      // IPv4 address of rank 0, which it listens on
+        {"port", "29500"},
+        {"alpha", "0"},             // 0: 1 / (3 L) from the per-sample smoothness
+        {"lambda", "1e-4"},
+        {"batch_size", "1"},
+        {"epochs", "10"},           // outer iterations
+        {"num_inner_iter", "0"},    // 0: 2 * shard size / batch_size
+        {"avg_period", "0"},        // inner iterations between model averages, 0: once per epoch
+        {"sample_opt", "0"},        // see lib/sampler.hpp
+        {"seed", "0"},              // 0: nondeterministic, not allowed with --rank
+        {"sample_period", "0"},     // 0: once per epoch
+        {"model", ""},              // written by rank 0, see lib/model.hpp
+    };
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string key = std::string(argv[i]).substr(2);
+        if (args.count(key) == 0) {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 1;
+        }
+        args[key] = argv[i + 1];
+    }
+    if (args["data"] == "") {
+        fprintf(stderr, "usage: %s --data <file> [--<key> <value> ...]\n", argv[0]);
+        return 1;
+    }
+    if (args["problem"] != "ridge" && args["problem"] != "ridge_prox" && args["problem"] != "lasso" &&
+        args["problem"] != "logistic") {
+        fprintf(stderr, "unknown problem %s\n", args["problem"].c_str());
+        return 1;
+    }
+    if (args["rank"] != "" && args["seed"] == "0") {
+        // The ranks are separate processes that could not agree on a random seed
+        fprintf(stderr, "--rank needs a nonzero --seed, the same on every rank\n");
+        return 1;
+    }
+    if (args["seed"] == "0") {
+        // All ranks started here must share the seed
+        args["seed"] = std::to_string(std::random_device()() | 1);
+    }
+
+    int num_worker = std::stoi(args["workers"]);
+    if (args["rank"] != "") {
+        return run_socket_worker(std::stoi(args["rank"]), args);
+    }
+
+    if (args["transport"] == "local") {
+        VRSGD::LocalGroup group(num_worker);
+        std::vector<std::thread> threads;
+        std::vector<int> status(num_worker);
+        for (int r = 0; r < num_worker; r++) {
+            threads.emplace_back([&, r]() {
+                VRSGD::LocalTransport transport(group, r);
+                status[r] = run_worker(transport, args);
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        return status[0];
+    }
+
+    fflush(stdout);
+    std::vector<pid_t> children;
+    for (int r = 1; r < num_worker; r++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            _exit(run_socket_worker(r, args));
+        }
+        children.push_back(pid);
+    }
+    int status = run_socket_worker(0, args);
+    for (pid_t pid : children) {
+        int child_status;
+        waitpid(pid, &child_status, 0);
+        if (!WIFEXITED(child_status) || WEXITSTATUS(child_status) != 0) {
+            status = 1;
+        }
+    }
+    return status;
+}
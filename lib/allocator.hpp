@@ -0,0 +1,222 @@
+#pragma once
+
+#include <sys/mman.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace VRSGD {
+
+/*
+ * Storage of the Vector buffers.
+ *
+ * Outside an ArenaScope a buffer comes from the heap, aligned to
+ * kVectorAlignment bytes so that the dense kernels run on whole cache lines.
+ * With set_huge_pages(true), buffers of at least kHugePageSize bytes (w and
+ * the gradient averages on wide data) are aligned to a huge page and advised
+ * to use transparent huge pages.
+ *
+ * Inside an ArenaScope the buffers of the Vectors created by the thread come
+ * from the arena, a bump allocator whose memory is reclaimed all at once when
+ * the scope ends. The solvers open one per iteration, so the temporaries of
+ * grad_func, operator* etc. no longer go through malloc and free.
+ *
+ * Assigning an arena Vector to one created outside the scope copies the
+ * values into the heap buffer of the latter (the allocator does not
+ * propagate on assignment), so
+ *   w = problem.prox_func(w + batch_w_change / batch_size, alpha, lambda);
+ * keeps w valid after the scope. A Vector constructed inside the scope must
+ * not outlive it.
+ */
+
+const std::size_t kVectorAlignment = 64;
+const std::size_t kHugePageSize = std::size_t(2) << 20;
+
+inline bool& huge_pages_flag() {
+    static bool enabled = false;
+    return enabled;
+}
+
+inline void set_huge_pages(bool enabled) { huge_pages_flag() = enabled; }
+
+// The raw pointer is kept right before the aligned block
+inline void* aligned_alloc_bytes(std::size_t bytes) {
+    bool huge = huge_pages_flag() && bytes >= kHugePageSize;
+    std::size_t alignment = huge ? kHugePageSize : kVectorAlignment;
+
+    char* raw = static_cast<char*>(::operator new(bytes + alignment + sizeof(void*)));
+    std::uintptr_t addr = reinterpret_cast<std::uintptr_t>(raw + sizeof(void*));
+    char* aligned = reinterpret_cast<char*>((addr + alignment - 1) & ~(alignment - 1));
+    reinterpret_cast<void**>(aligned)[-1] = raw;
+
+#ifdef MADV_HUGEPAGE
+    if (huge) {
+        madvise(aligned, bytes & ~(kHugePageSize - 1), MADV_HUGEPAGE);
+    }
+#endif
+    return aligned;
+}
+
+inline void aligned_free_bytes(void* ptr) {
+    if (ptr) {
+        ::operator delete(reinterpret_cast<void**>(ptr)[-1]);
+    }
+}
+
+class Arena {
+   public:
+    // Position to roll back to, see release()
+    struct Mark {
+        std::size_t chunk;
+        std::size_t offset;
+    };
+
+    explicit Arena(std::size_t chunk_size = std::size_t(1) << 20) : chunk_size(chunk_size) {}
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    ~Arena() {
+        for (auto& chunk : chunks) {
+            aligned_free_bytes(chunk.data);
+        }
+    }
+
+    void* allocate(std::size_t bytes) {
+        bytes = (bytes + kVectorAlignment - 1) & ~(kVectorAlignment - 1);
+        while (cur_chunk < chunks.size() && offset + bytes > chunks[cur_chunk].size) {
+            cur_chunk++;
+            offset = 0;
+        }
+        if (cur_chunk == chunks.size()) {
+            std::size_t size = bytes > chunk_size ? bytes : chunk_size;
+            chunks.push_back({static_cast<char*>(aligned_alloc_bytes(size)), size});
+            offset = 0;
+        }
+        void* res = chunks[cur_chunk].data + offset;
+        offset += bytes;
+        return res;
+    }
+
+    inline Mark mark() const { return {cur_chunk, offset}; }
+
+    // Frees everything allocated after m, the chunks are kept for reuse
+    inline void release(const Mark& m) {
+        cur_chunk = m.chunk;
+        offset = m.offset;
+    }
+
+    // Bytes held by the arena
+    std::size_t capacity() const {
+        std::size_t res = 0;
+        for (auto& chunk : chunks) {
+            res += chunk.size;
+        }
+        return res;
+    }
+
+   private:
+    struct Chunk {
+        char* data;
+        std::size_t size;
+    };
+
+    std::vector<Chunk> chunks;
+    std::size_t cur_chunk = 0;
+    std::size_t offset = 0;
+    std::size_t chunk_size;
+};
+
+// Arena used by the Vectors the thread creates, nullptr outside ArenaScope
+inline Arena*& current_arena() {
+    static thread_local Arena* arena = nullptr;
+    return arena;
+}
+
+// Per-thread arena for the solver iterations
+inline Arena& scratch_arena() {
+    static thread_local Arena arena;
+    return arena;
+}
+
+/*
+ * Routes the Vectors created by this thread to arena until the scope ends,
+ * then frees them at once. Scopes nest.
+ */
+class ArenaScope {
+   public:
+    explicit ArenaScope(Arena& arena = scratch_arena()) : arena(arena), mark(arena.mark()), prev(current_arena()) {
+        current_arena() = &arena;
+    }
+
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+
+    ~ArenaScope() {
+        current_arena() = prev;
+        arena.release(mark);
+    }
+
+   private:
+    Arena& arena;
+    Arena::Mark mark;
+    Arena* prev;
+};
+
+/*
+ * Allocator of the Vector buffers: from the arena of the enclosing ArenaScope
+ * at construction, otherwise aligned from the heap.
+ */
+template <typename T>
+class VectorAllocator {
+   public:
+    typedef T value_type;
+    typedef std::false_type propagate_on_container_copy_assignment;
+    typedef std::false_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+    typedef std::false_type is_always_equal;
+
+    template <typename U>
+    struct rebind {
+        typedef VectorAllocator<U> other;
+    };
+
+    VectorAllocator() : arena(current_arena()) {}
+
+    template <typename U>
+    VectorAllocator(const VectorAllocator<U>& b) : arena(b.get_arena()) {}
+
+    inline T* allocate(std::size_t n) {
+        std::size_t bytes = n * sizeof(T);
+        return static_cast<T*>(arena ? arena->allocate(bytes) : aligned_alloc_bytes(bytes));
+    }
+
+    inline void deallocate(T* ptr, std::size_t) {
+        if (!arena) {
+            aligned_free_bytes(ptr);
+        }
+    }
+
+    // A copy is placed according to where it is made, not where its source lives
+    inline VectorAllocator select_on_container_copy_construction() const { return VectorAllocator(); }
+
+    inline Arena* get_arena() const { return arena; }
+
+   private:
+    Arena* arena;
+};
+
+template <typename T, typename U>
+inline bool operator==(const VectorAllocator<T>& a, const VectorAllocator<U>& b) {
+    return a.get_arena() == b.get_arena();
+}
+
+template <typename T, typename U>
+inline bool operator!=(const VectorAllocator<T>& a, const VectorAllocator<U>& b) {
+    return !(a == b);
+}
+
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+// Hot-path instrumentation for the Vector operations. Compile with
+// -DVRSGD_COUNTERS to count calls, bytes touched and temporaries allocated per
+// operation; without it the macros expand to nothing.
+
+#ifdef VRSGD_COUNTERS
+
+#include <cstdio>
+#include <cstring>
+
+namespace VRSGD {
+
+enum CounterOp {
+    OP_DOT,
+    OP_AXPY,
+    OP_ADD,
+    OP_SCALE,
+    OP_NEG,
+    OP_INTCPT,
+    OP_PROX,
+    NUM_COUNTER_OP
+};
+
+static const char* const counter_op_names[NUM_COUNTER_OP] = {"dot", "axpy", "add", "scale", "neg", "intcpt", "prox"};
+
+struct OpCounters {
+    long long calls[NUM_COUNTER_OP];
+    long long bytes[NUM_COUNTER_OP];
+    long long temps;
+    long long temp_bytes;
+
+    OpCounters() { reset(); }
+
+    void reset() { memset(this, 0, sizeof(*this)); }
+
+    // Dumps the counters as a JSON object, divided by the number of solver
+    // iterations they were collected over
+    void print(FILE* out, double num_iter = 1) const {
+        fprintf(out, "{");
+        for (int op = 0; op < NUM_COUNTER_OP; op++) {
+            fprintf(out, "\"%s_calls\": %.2f, \"%s_bytes\": %.1f, ", counter_op_names[op], calls[op] / num_iter,
+                    counter_op_names[op], bytes[op] / num_iter);
+        }
+        fprintf(out, "\"temps\": %.2f, \"temp_bytes\": %.1f}", temps / num_iter, temp_bytes / num_iter);
+    }
+};
+
+inline OpCounters& op_counters() {
+    static thread_local OpCounters counters;
+    return counters;
+}
+
+}
+
+#define VRSGD_COUNT_OP(op, nbytes)                           \
+    do {                                                     \
+        VRSGD::op_counters().calls[VRSGD::op]++;             \
+        VRSGD::op_counters().bytes[VRSGD::op] += (nbytes);   \
+    } while (0)
+
+#define VRSGD_COUNT_TEMP(nbytes)                     \
+    do {                                             \
+        VRSGD::op_counters().temps++;                \
+        VRSGD::op_counters().temp_bytes += (nbytes); \
+    } while (0)
+
+#else
+
+#define VRSGD_COUNT_OP(op, nbytes) \
+    do {                           \
+    } while (0)
+
+#define VRSGD_COUNT_TEMP(nbytes) \
+    do {                         \
+    } while (0)
+
+#endif
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "data_view.hpp"
+#include "model.hpp"
+#include "random.hpp"
+#include "scoring.hpp"
+#include "utils.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+namespace VRSGD {
+
+// Validation metrics of one fold, see Metrics
+struct FoldResult {
+    long long size = 0;
+    double rmse = 0;
+    double accuracy = 0;
+    double auc = 0;
+};
+
+// Rows shuffled once with seed and cut into num_folds contiguous folds
+class KFold {
+   public:
+    KFold(int data_num, int num_folds, uint64_t seed) : perm(data_num), num_folds(num_folds) {
+        std::iota(perm.begin(), perm.end(), 0);
+        Xoshiro256 gen(seed);
+        VRSGD::shuffle(perm.begin(), perm.end(), gen);
+    }
+
+    std::vector<int> valid_rows(int fold) const {
+        return std::vector<int>(perm.begin() + begin(fold), perm.begin() + begin(fold + 1));
+    }
+
+    std::vector<int> train_rows(int fold) const {
+        std::vector<int> rows(perm.begin(), perm.begin() + begin(fold));
+        rows.insert(rows.end(), perm.begin() + begin(fold + 1), perm.end());
+        return rows;
+    }
+
+   private:
+    inline int begin(int fold) const { return (long long)perm.size() * fold / num_folds; }
+
+    std::vector<int> perm;
+    int num_folds;
+};
+
+/*
+ * k-fold cross-validation over one loaded dataset. Every fold trains on a
+ * DataView of the other folds' rows, so no row is copied or parsed again,
+ * and the folds run concurrently on num_threads threads.
+ *
+ * @param train_fold
+ * train_fold(fold, train_rows) returns the Model trained on train_rows; it is
+ * called from several threads at once
+ *
+ * @return the validation metrics of every fold, see average_folds()
+ */
+template <typename PointT, typename TrainFunc>
+std::vector<FoldResult> cross_validate(const std::vector<PointT>& data_points, int num_folds, uint64_t seed,
+                                       int num_threads, TrainFunc train_fold) {
+    KFold kfold(data_points.size(), num_folds, seed);
+    std::vector<FoldResult> results(num_folds);
+
+    parallel_tasks(num_folds, num_threads, [&](int fold, int) {
+        Model model = train_fold(fold, DataView<PointT>(data_points, kfold.train_rows(fold)));
+        Scorer scorer(model);
+
+        Metrics metrics(1 << 16);
+        for (int row : kfold.valid_rows(fold)) {
+            double margin = scorer.margin(data_points[row].x);
+            metrics.add(margin, scorer.predict(margin), data_points[row].y);
+        }
+        results[fold].size = metrics.size();
+        results[fold].rmse = metrics.rmse();
+        results[fold].accuracy = metrics.accuracy();
+        results[fold].auc = metrics.auc();
+    });
+
+    return results;
+}
+
+// Mean of the fold metrics, weighted by the fold sizes
+inline FoldResult average_folds(const std::vector<FoldResult>& results) {
+    FoldResult res;
+    double sum_sqr_err = 0;
+    for (const auto& result : results) {
+        res.size += result.size;
+        sum_sqr_err += result.rmse * result.rmse * result.size;
+        res.accuracy += result.accuracy * result.size;
+        res.auc += result.auc * result.size;
+    }
+    if (res.size > 0) {
+        res.rmse = std::sqrt(sum_sqr_err / res.size);
+        res.accuracy /= res.size;
+        res.auc /= res.size;
+    }
+    return res;
+}
+
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace VRSGD {
+
+/*
+ * Read-only view of rows of a loaded dataset, what the problem classes train
+ * on. It converts implicitly from the whole std::vector, and with a list of
+ * row indices it selects a subset, e.g. the training rows of a
+ * cross-validation fold, without copying any row. The dataset must outlive
+ * the view.
+ */
+template <typename PointT>
+class DataView {
+   public:
+    class ConstIterator {
+       public:
+        ConstIterator(const DataView& view, std::size_t idx) : view(view), idx(idx) {}
+
+        inline const PointT& operator*() const { return view[idx]; }
+
+        inline const PointT* operator->() const { return &view[idx]; }
+
+        inline ConstIterator& operator++() {
+            idx++;
+            return *this;
+        }
+
+        inline bool operator==(const ConstIterator& b) const { return idx == b.idx; }
+
+        inline bool operator!=(const ConstIterator& b) const { return idx != b.idx; }
+
+       private:
+        const DataView& view;
+        std::size_t idx;
+    };
+
+    DataView(const std::vector<PointT>& data) : data(&data), all(true) {}
+
+    DataView(const std::vector<PointT>& data, std::vector<int> rows) : data(&data), rows(std::move(rows)), all(false) {}
+
+    inline const PointT& operator[](std::size_t idx) const { return all ? (*data)[idx] : (*data)[rows[idx]]; }
+
+    inline std::size_t size() const { return all ? data->size() : rows.size(); }
+
+    inline bool empty() const { return size() == 0; }
+
+    inline ConstIterator begin() const { return ConstIterator(*this, 0); }
+
+    inline ConstIterator end() const { return ConstIterator(*this, size()); }
+
+   private:
+    const std::vector<PointT>* data;
+    std::vector<int> rows;
+    bool all;
+};
+
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "model.hpp"
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+namespace VRSGD {
+
+/*
+ * Hashing trick for feature ids from an unbounded space, e.g. 64-bit ids of
+ * click logs: raw id j becomes feature bucket(j) in [0, 2^bits) with value
+ * sign(j) * val. The sign makes colliding features cancel in expectation
+ * instead of adding up, and the features of a row hashed to the same bucket
+ * are summed (see parse_libsvm_line), so w has 2^bits weights whatever the
+ * raw ids are.
+ *
+ * save() and load() keep bits and seed in Model::meta, so that score maps
+ * the ids as train did.
+ */
+class FeatureHasher {
+   public:
+    int bits = 0;
+    uint64_t seed = 0;
+
+    FeatureHasher() = default;
+
+    FeatureHasher(int bits, uint64_t seed = 0) : bits(bits), seed(seed) {}
+
+    // bits 0 disables hashing
+    inline bool enabled() const { return bits > 0; }
+
+    inline int num_buckets() const { return 1 << bits; }
+
+    // Feature index of raw id, sign receives +1 or -1
+    inline int bucket(uint64_t raw, double& sign) const {
+        uint64_t h = mix(raw ^ seed);
+        sign = (h >> 63) ? -1. : 1.;
+        return h & ((uint64_t(1) << bits) - 1);
+    }
+
+    void save(Model& model) const {
+        if (!enabled()) {
+            return;
+        }
+        std::ostringstream ss;
+        ss << "bits " << bits << " seed " << seed;
+        model.meta["hashing"] = ss.str();
+    }
+
+    bool load(const Model& model) {
+        auto it = model.meta.find("hashing");
+        if (it == model.meta.end()) {
+            return true;
+        }
+
+        std::istringstream ss(it->second);
+        std::string key;
+        while (ss >> key) {
+            if (key == "bits") {
+                ss >> bits;
+            } else if (key == "seed") {
+                ss >> seed;
+            } else {
+                return false;
+            }
+        }
+        return !ss.bad() && bits > 0 && bits <= 30;
+    }
+
+   private:
+    // Finalizer of MurmurHash3, every input bit affects every output bit
+    static inline uint64_t mix(uint64_t h) {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+};
+
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "vector.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <string>
+
+namespace VRSGD {
+
+/*
+ * A trained linear model as written by train and read by score. The text
+ * format is a "vrsgd_model 1" line, then "key value" lines, then "w <size>"
+ * followed by one weight per line. Keys other than problem and feature_num
+ * end up in meta, which lets later stages (e.g. preprocessing) attach their
+ * parameters without changing the format.
+ */
+struct Model {
+    std::string problem;
+    int feature_num = 0;
+    DenseVector<double> w;
+    std::map<std::string, std::string> meta;
+
+    // w holds a trailing intercept, see LogisticRegression
+    inline bool has_intercept() const { return w.get_feature_num() == feature_num + 1; }
+};
+
+inline bool save_model(const Model& model, const std::string& filename) {
+    FILE* fp = fopen(filename.c_str(), "w");
+    if (!fp) {
+        return false;
+    }
+
+    fprintf(fp, "vrsgd_model 1\n");
+    fprintf(fp, "problem %s\n", model.problem.c_str());
+    fprintf(fp, "feature_num %d\n", model.feature_num);
+    for (const auto& entry : model.meta) {
+        fprintf(fp, "%s %s\n", entry.first.c_str(), entry.second.c_str());
+    }
+    fprintf(fp, "w %d\n", model.w.get_feature_num());
+    for (int i = 0; i < model.w.get_feature_num(); i++) {
+        fprintf(fp, "%.17g\n", model.w[i]);
+    }
+
+    return fclose(fp) == 0;
+}
+
+inline bool load_model(Model& model, const std::string& filename) {
+    std::ifstream fs(filename);
+    std::string key;
+    int version;
+    if (!(fs >> key >> version) || key != "vrsgd_model" || version != 1) {
+        return false;
+    }
+
+    while (fs >> key) {
+        if (key == "w") {
+            int size;
+            fs >> size;
+            model.w = DenseVector<double>(size);
+            for (int i = 0; i < size; i++) {
+                fs >> model.w[i];
+            }
+            return (bool)fs;
+        }
+
+        std::string value;
+        std::getline(fs >> std::ws, value);
+        if (key == "problem") {
+            model.problem = value;
+        } else if (key == "feature_num") {
+            model.feature_num = std::stoi(value);
+        } else {
+            model.meta[key] = value;
+        }
+    }
+
+    return false;
+}
+
+}
@@ -0,0 +1,166 @@
+#pragma once
+
+#include "utils.hpp"
+
+#include <sched.h>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace VRSGD {
+
+/*
+ * NUMA nodes and their CPUs, read from /sys/devices/system/node and limited
+ * to the CPUs the process may run on. Without that directory, e.g. on a
+ * kernel built without NUMA, all CPUs form one node.
+ *
+ * Worker t of num_worker goes to node t * num_nodes / num_worker, so that the
+ * contiguous row partitions of parallel_for map to contiguous node ranges.
+ */
+class NumaTopology {
+   public:
+    NumaTopology() {
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+            for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+                CPU_SET(cpu, &allowed);
+            }
+        }
+
+        for (int node = 0;; node++) {
+            std::ifstream fs("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+            if (!fs) {
+                // Node ids may have holes up to the last possible one
+                if (node < max_node_id()) {
+                    continue;
+                }
+                break;
+            }
+            std::string cpulist;
+            std::getline(fs, cpulist);
+
+            std::vector<int> cpus;
+            for (int cpu : parse_cpulist(cpulist)) {
+                if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)) {
+                    cpus.push_back(cpu);
+                }
+            }
+            if (!cpus.empty()) {
+                node_cpus.push_back(cpus);
+            }
+        }
+
+        if (node_cpus.empty()) {
+            std::vector<int> cpus;
+            for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+                if (CPU_ISSET(cpu, &allowed)) {
+                    cpus.push_back(cpu);
+                }
+            }
+            node_cpus.push_back(cpus);
+        }
+    }
+
+    inline int num_nodes() const { return node_cpus.size(); }
+
+    inline const std::vector<int>& cpus(int node) const { return node_cpus[node]; }
+
+    inline int worker_node(int worker, int num_worker) const {
+        return (long long)worker * num_nodes() / num_worker;
+    }
+
+    // Workers of a node are spread over its CPUs in order
+    int worker_cpu(int worker, int num_worker) const {
+        int node = worker_node(worker, num_worker);
+        int first = 0;
+        while (worker_node(first, num_worker) != node) {
+            first++;
+        }
+        const auto& node_cpu = node_cpus[node];
+        return node_cpu[(worker - first) % node_cpu.size()];
+    }
+
+    // e.g. "0-7,16-23"
+    static std::vector<int> parse_cpulist(const std::string& cpulist) {
+        std::vector<int> res;
+        std::stringstream ss(cpulist);
+        std::string range;
+        while (std::getline(ss, range, ',')) {
+            int first, last;
+            int num = sscanf(range.c_str(), "%d-%d", &first, &last);
+            if (num == 1) {
+                last = first;
+            } else if (num != 2) {
+                continue;
+            }
+            for (int cpu = first; cpu <= last; cpu++) {
+                res.push_back(cpu);
+            }
+        }
+        return res;
+    }
+
+   private:
+    static int max_node_id() {
+        std::ifstream fs("/sys/devices/system/node/possible");
+        std::string possible;
+        std::getline(fs, possible);
+        auto nodes = parse_cpulist(possible);
+        return nodes.empty() ? 0 : nodes.back();
+    }
+
+    std::vector<std::vector<int>> node_cpus;
+};
+
+// Pins the calling thread to one CPU
+inline bool pin_thread(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+/*
+ * parallel_for with thread t pinned to topology.worker_cpu(t, num_threads)
+ * before it runs func. Memory first written by func, e.g. a worker's
+ * gradient table or its copy of w, is then placed on the worker's node by the
+ * kernel's first-touch policy. A null topology runs parallel_for unpinned.
+ */
+template<typename Func>
+void numa_parallel_for(int num, int num_threads, const NumaTopology* topology, Func func) {
+    int num_worker = num_threads <= 1 || num < num_threads ? 1 : num_threads;
+    // A single worker runs on the calling thread, which is left unpinned
+    if (!topology || num_worker == 1) {
+        parallel_for(num, num_threads, func);
+        return;
+    }
+
+    parallel_for(num, num_worker, [&](int begin, int end, int thread_id) {
+        pin_thread(topology->worker_cpu(thread_id, num_worker));
+        func(begin, end, thread_id);
+    });
+}
+
+/*
+ * Moves the feature buffers of the rows in the partition of worker t of
+ * num_threads (the partitions of parallel_for, as used by async_saga_train)
+ * onto the node of that worker: every row is copied from a pinned thread and
+ * the copy replaces the original. The array of LabeledPoint headers itself
+ * stays where it was loaded.
+ */
+template <typename T, typename U, bool is_sparse>
+void numa_place_rows(std::vector<LabeledPoint<Vector<T, is_sparse>, U>>& data_points, int num_threads,
+                     const NumaTopology& topology) {
+    numa_parallel_for(data_points.size(), num_threads, &topology, [&](int begin, int end, int) {
+        for (int i = begin; i < end; i++) {
+            Vector<T, is_sparse> local(data_points[i].x);
+            data_points[i].x = std::move(local);
+        }
+    });
+}
+
+}
@@ -0,0 +1,197 @@
+#pragma once
+
+#include "vector.hpp"
+#include "utils.hpp"
+#include "model.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace VRSGD {
+
+/*
+ * Declarative preprocessing of loaded rows. The enabled steps run fused, one
+ * multithreaded pass over the rows, always in this order:
+ *   1. label remap: y < label_threshold becomes negative, the rest 1
+ *   2. target scaling: y /= max |y| over the training rows
+ *   3. row normalization to unit L2 norm
+ *   4. column standardization: feature j is divided by its root mean square
+ *      over the training rows (after step 3); it is not centered, which keeps
+ *      the rows sparse
+ *
+ * fit() computes the statistics of steps 2 and 4, in one more pass. save()
+ * and load() keep the steps and statistics in Model::meta, so that scoring
+ * replays exactly what training did.
+ */
+class Preprocess {
+   public:
+    bool map_label = false;
+    double label_threshold = 0;
+    double negative = -1;
+    bool scale_target = false;
+    bool normalize = false;
+    bool standardize = false;
+
+    // Statistics from fit()
+    double target_scale = 1;
+    std::vector<double> col_scale;
+
+    inline bool empty() const { return !map_label && !scale_target && !normalize && !standardize; }
+
+    template <typename T, typename U, bool is_sparse>
+    void fit(const std::vector<LabeledPoint<Vector<T, is_sparse>, U>>& data_points, int feature_num, int num_threads) {
+        if (!scale_target && !standardize) {
+            return;
+        }
+
+        std::vector<double> max_y(num_threads, 0);
+        std::vector<std::vector<double>> sum_sqr(num_threads);
+        parallel_for(data_points.size(), num_threads, [&](int begin, int end, int thread_id) {
+            if (standardize) {
+                sum_sqr[thread_id].assign(feature_num, 0);
+            }
+            for (int i = begin; i < end; i++) {
+                const auto& data_point = data_points[i];
+                max_y[thread_id] = std::max(max_y[thread_id], std::abs(remap(data_point.y)));
+                if (standardize) {
+                    double row_scale = row_norm_scale(data_point.x);
+                    for (auto it = data_point.x.begin_feaval(); it != data_point.x.end_feaval(); ++it) {
+                        const auto& entry = *it;
+                        double val = entry.val * row_scale;
+                        sum_sqr[thread_id][entry.fea] += val * val;
+                    }
+                }
+            }
+        });
+
+        if (scale_target) {
+            target_scale = *std::max_element(max_y.begin(), max_y.end());
+            if (target_scale == 0) {
+                target_scale = 1;
+            }
+        }
+        if (standardize) {
+            col_scale.assign(feature_num, 1);
+            for (int j = 0; j < feature_num; j++) {
+                double sum = 0;
+                for (const auto& thread_sum : sum_sqr) {
+                    sum += thread_sum.empty() ? 0 : thread_sum[j];
+                }
+                double rms = std::sqrt(sum / data_points.size());
+                col_scale[j] = rms > 0 ? 1. / rms : 1.;
+            }
+        }
+    }
+
+    template <typename T, typename U, bool is_sparse>
+    inline void apply(LabeledPoint<Vector<T, is_sparse>, U>& data_point) const {
+        data_point.y = remap(data_point.y) / target_scale;
+
+        double row_scale = row_norm_scale(data_point.x);
+        if (row_scale != 1 || standardize) {
+            for (auto it = data_point.x.begin_feaval(); it != data_point.x.end_feaval(); ++it) {
+                auto&& entry = *it;
+                T val = entry.val * row_scale;
+                if (standardize && entry.fea < (int)col_scale.size()) {
+                    val *= col_scale[entry.fea];
+                }
+                entry.val = val;
+            }
+        }
+    }
+
+    template <typename T, typename U, bool is_sparse>
+    void apply(std::vector<LabeledPoint<Vector<T, is_sparse>, U>>& data_points, int num_threads) const {
+        if (empty()) {
+            return;
+        }
+        parallel_for(data_points.size(), num_threads, [&](int begin, int end, int) {
+            for (int i = begin; i < end; i++) {
+                apply(data_points[i]);
+            }
+        });
+    }
+
+    void save(Model& model) const {
+        if (empty()) {
+            return;
+        }
+
+        std::ostringstream ss;
+        ss.precision(17);
+        ss << "map_label " << map_label << " label_threshold " << label_threshold << " negative " << negative
+           << " scale_target " << scale_target << " target_scale " << target_scale << " normalize " << normalize
+           << " standardize " << standardize;
+        model.meta["preprocess"] = ss.str();
+
+        if (standardize) {
+            std::ostringstream cols;
+            cols.precision(17);
+            for (std::size_t j = 0; j < col_scale.size(); j++) {
+                cols << (j ? " " : "") << col_scale[j];
+            }
+            model.meta["preprocess_col_scale"] = cols.str();
+        }
+    }
+
+    bool load(const Model& model) {
+        auto it = model.meta.find("preprocess");
+        if (it == model.meta.end()) {
+            return true;
+        }
+
+        std::istringstream ss(it->second);
+        std::string key;
+        while (ss >> key) {
+            if (key == "map_label") {
+                ss >> map_label;
+            } else if (key == "label_threshold") {
+                ss >> label_threshold;
+            } else if (key == "negative") {
+                ss >> negative;
+            } else if (key == "scale_target") {
+                ss >> scale_target;
+            } else if (key == "target_scale") {
+                ss >> target_scale;
+            } else if (key == "normalize") {
+                ss >> normalize;
+            } else if (key == "standardize") {
+                ss >> standardize;
+            } else {
+                return false;
+            }
+        }
+
+        col_scale.clear();
+        if (standardize) {
+            auto cols = model.meta.find("preprocess_col_scale");
+            if (cols == model.meta.end()) {
+                return false;
+            }
+            std::istringstream cs(cols->second);
+            double val;
+            while (cs >> val) {
+                col_scale.push_back(val);
+            }
+        }
+        return !ss.bad();
+    }
+
+   private:
+    inline double remap(double y) const { return map_label ? (y < label_threshold ? negative : 1) : y; }
+
+    template <typename T, bool is_sparse>
+    inline double row_norm_scale(const Vector<T, is_sparse>& x) const {
+        if (!normalize) {
+            return 1;
+        }
+        double norm = x.norm();
+        return norm > 0 ? 1. / norm : 1;
+    }
+};
+
+}
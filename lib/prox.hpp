@@ -8,11 +8,14 @@ namespace VRSGD {
 
 template<typename T, bool is_sparse>
 inline Vector<T, is_sparse> prox_l2(const Vector<T, is_sparse>& y, T alpha, T lambda) {
+    VRSGD_COUNT_OP(OP_PROX, 0);
     return y / (1 + alpha * lambda);
 }
 
 template <typename T, bool is_sparse>
 Vector<T, is_sparse> prox_l1(const Vector<T, is_sparse>& y, T lambda) {
+    VRSGD_COUNT_OP(OP_PROX, 2 * y.get_nnz() * sizeof(T));
+    VRSGD_COUNT_TEMP(y.get_nnz() * sizeof(T));
     Vector<T, is_sparse> res(y.get_feature_num());
 
     for (auto it = y.begin_feaval(); it != y.end_feaval(); ++it) {
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <utility>
+
+namespace VRSGD {
+
+/*
+ * Generators used for sample selection. Any RNG plugged into Sampler must be
+ * constructible from (seed, stream) and model UniformRandomBitGenerator with a
+ * 64-bit result_type. Generators with the same seed and different stream ids
+ * produce independent sequences, so each thread of a parallel solver can own
+ * one and runs stay reproducible regardless of scheduling.
+ */
+
+class SplitMix64 {
+   public:
+    typedef uint64_t result_type;
+
+    explicit SplitMix64(uint64_t seed = 0) : state(seed) {}
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+    inline result_type operator()() {
+        uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+   private:
+    uint64_t state;
+};
+
+// xoshiro256++ (Blackman and Vigna), 32 bytes of state
+class Xoshiro256 {
+   public:
+    typedef uint64_t result_type;
+
+    explicit Xoshiro256(uint64_t seed = 0, uint64_t stream = 0) {
+        SplitMix64 sm(seed);
+        for (auto& x : s) {
+            x = sm();
+        }
+        for (uint64_t i = 0; i < stream; i++) {
+            jump();
+        }
+    }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+    inline result_type operator()() {
+        uint64_t res = rotl(s[0] + s[3], 23) + s[0];
+        uint64_t t = s[1] << 17;
+
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+
+        return res;
+    }
+
+    // Advance by 2^128 draws, i.e. to the start of the next non-overlapping stream
+    void jump() {
+        static const uint64_t JUMP[] = {0x180ec6d33cfd0aba, 0xd5a61266f0c9392c, 0xa9582618e03fc9aa, 0x39abdc4529b1661c};
+
+        uint64_t t[4] = {0, 0, 0, 0};
+        for (uint64_t j : JUMP) {
+            for (int b = 0; b < 64; b++) {
+                if (j & (uint64_t(1) << b)) {
+                    for (int k = 0; k < 4; k++) {
+                        t[k] ^= s[k];
+                    }
+                }
+                (*this)();
+            }
+        }
+        for (int k = 0; k < 4; k++) {
+            s[k] = t[k];
+        }
+    }
+
+   private:
+    static inline uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+    uint64_t s[4];
+};
+
+// Philox4x32-10 (Salmon et al.), counter-based: the n-th output is a pure
+// function of (seed, stream, n), so a stream can be split or skipped freely
+class Philox4x32 {
+   public:
+    typedef uint64_t result_type;
+
+    explicit Philox4x32(uint64_t seed = 0, uint64_t stream = 0) {
+        key[0] = (uint32_t)seed;
+        key[1] = (uint32_t)(seed >> 32);
+        ctr[0] = ctr[1] = 0;
+        ctr[2] = (uint32_t)stream;
+        ctr[3] = (uint32_t)(stream >> 32);
+    }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+    inline result_type operator()() {
+        if (idx == 2) {
+            generate();
+        }
+        uint64_t res = ((uint64_t)out[2 * idx + 1] << 32) | out[2 * idx];
+        idx++;
+        return res;
+    }
+
+    // Jump to the n-th block of 128 bits within the current stream
+    void seek(uint64_t n) {
+        ctr[0] = (uint32_t)n;
+        ctr[1] = (uint32_t)(n >> 32);
+        idx = 2;
+    }
+
+   private:
+    void generate() {
+        uint32_t c[4] = {ctr[0], ctr[1], ctr[2], ctr[3]};
+        uint32_t k[2] = {key[0], key[1]};
+
+        for (int r = 0; r < 10; r++) {
+            uint64_t p0 = (uint64_t)0xD2511F53 * c[0];
+            uint64_t p1 = (uint64_t)0xCD9E8D57 * c[2];
+            uint32_t n0 = (uint32_t)(p1 >> 32) ^ c[1] ^ k[0];
+            uint32_t n2 = (uint32_t)(p0 >> 32) ^ c[3] ^ k[1];
+            c[0] = n0;
+            c[1] = (uint32_t)p1;
+            c[2] = n2;
+            c[3] = (uint32_t)p0;
+            k[0] += 0x9E3779B9;
+            k[1] += 0xBB67AE85;
+        }
+
+        for (int i = 0; i < 4; i++) {
+            out[i] = c[i];
+        }
+        if (++ctr[0] == 0) {
+            ++ctr[1];
+        }
+        idx = 0;
+    }
+
+    uint32_t key[2];
+    uint32_t ctr[4];
+    uint32_t out[4];
+    int idx = 2;
+};
+
+// Uniform integer in [0, range) by Lemire's multiply-shift method; the
+// modulo is only computed on the rare rejection path
+template <typename RNG>
+inline uint32_t bounded_rand(RNG& gen, uint32_t range) {
+    uint32_t x = (uint32_t)(gen() >> 32);
+    uint64_t m = (uint64_t)x * range;
+    uint32_t l = (uint32_t)m;
+    if (l < range) {
+        uint32_t t = -range % range;
+        while (l < t) {
+            x = (uint32_t)(gen() >> 32);
+            m = (uint64_t)x * range;
+            l = (uint32_t)m;
+        }
+    }
+    return m >> 32;
+}
+
+// Uniform double in [0, 1)
+template <typename RNG>
+inline double uniform_real(RNG& gen) {
+    return (gen() >> 11) * (1. / 9007199254740992.);
+}
+
+// Fisher-Yates shuffle on top of bounded_rand
+template <typename RandomIt, typename RNG>
+void shuffle(RandomIt first, RandomIt last, RNG& gen) {
+    auto n = std::distance(first, last);
+    for (auto i = n - 1; i > 0; i--) {
+        using std::swap;
+        swap(first[i], first[bounded_rand(gen, (uint32_t)(i + 1))]);
+    }
+}
+
+}
@@ -0,0 +1,287 @@
+#pragma once
+
+#include "vector.hpp"
+#include "random.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <vector>
+
+namespace VRSGD {
+
+/*
+ * @param sample_opt
+ * 0: uniform sampling with replacement
+ * 1: random reshuffling, a fresh permutation of all rows every epoch
+ * 2: cyclic, rows are visited in storage order
+ * 3: block shuffling, the order of the blocks and the rows inside each block
+ *    are shuffled every epoch, so consecutive draws stay within a cache-sized
+ *    window of the data
+ * 4: importance sampling, row i is drawn with probability L_i / sum_j L_j where
+ *    L_i = problem.smoothness(i); weight(i) = 1 / (n p_i) must be applied to
+ *    the sampled gradient difference to keep the estimator unbiased
+ *
+ * @param seed, stream
+ * runs with the same seed and stream draw the same rows; give each thread of a
+ * parallel solver its own stream
+ *
+ * @param block_size
+ * number of rows in a block for sample_opt 3, see cache_block_size()
+ *
+ * focus(first_row, prob) draws from rows [first_row, data_num), e.g. rows
+ * appended for incremental training, with probability prob and from the
+ * schedule of sample_opt otherwise. Like importance sampling it weights the
+ * rows by 1 / (n p_i). It is ignored with sample_opt 4.
+ */
+
+// Walker's alias method: O(n) construction, O(1) draws from a discrete
+// distribution proportional to the given weights
+class AliasTable {
+   public:
+    AliasTable() = default;
+
+    explicit AliasTable(const std::vector<double>& weights) : prob(weights.size()), alias(weights.size()) {
+        int n = weights.size();
+        double sum = std::accumulate(weights.begin(), weights.end(), 0.);
+
+        std::vector<double> scaled(n);
+        std::vector<int> small, large;
+        for (int i = 0; i < n; i++) {
+            scaled[i] = weights[i] * n / sum;
+            if (scaled[i] < 1) {
+                small.push_back(i);
+            } else {
+                large.push_back(i);
+            }
+        }
+
+        while (!small.empty() && !large.empty()) {
+            int s = small.back();
+            int l = large.back();
+            small.pop_back();
+
+            prob[s] = scaled[s];
+            alias[s] = l;
+            scaled[l] -= 1 - scaled[s];
+            if (scaled[l] < 1) {
+                large.pop_back();
+                small.push_back(l);
+            }
+        }
+        // leftovers are 1 up to rounding
+        for (int i : large) {
+            prob[i] = 1;
+            alias[i] = i;
+        }
+        for (int i : small) {
+            prob[i] = 1;
+            alias[i] = i;
+        }
+
+    }
+
+    template <typename RNG>
+    inline int operator()(RNG& gen) {
+        int col = bounded_rand(gen, prob.size());
+        return uniform_real(gen) < prob[col] ? col : alias[col];
+    }
+
+   private:
+    std::vector<double> prob;
+    std::vector<int> alias;
+};
+
+template <typename RNG = Xoshiro256>
+class Sampler {
+   public:
+    Sampler(int sample_opt = 0, uint64_t seed = std::random_device()(), int block_size = 1024, uint64_t stream = 0)
+        : sample_opt(sample_opt), block_size(block_size), gen(seed, stream) {}
+
+    template <typename ProblemT>
+    void init(ProblemT& problem) {
+        init(problem.size());
+
+        if (sample_opt == 4) {
+            std::vector<double> L(data_num);
+            for (int i = 0; i < data_num; i++) {
+                L[i] = problem.smoothness(i);
+            }
+            double avg_L = std::accumulate(L.begin(), L.end(), 0.) / data_num;
+
+            weights.resize(data_num);
+            for (int i = 0; i < data_num; i++) {
+                weights[i] = L[i] > 0 ? avg_L / L[i] : 0;
+            }
+            alias_table = AliasTable(L);
+        }
+    }
+
+    void init(int data_num) {
+        this->data_num = data_num;
+        pos = 0;
+
+        focused = focus_prob > 0 && focus_begin < data_num && sample_opt != 4;
+        if (focused) {
+            // p_i = (1 - prob) / n for the old rows, plus prob / m for the m new ones
+            int focus_num = data_num - focus_begin;
+            old_weight = 1. / (1. - focus_prob);
+            new_weight = 1. / (1. - focus_prob + focus_prob * data_num / focus_num);
+        }
+
+        if (sample_opt == 1 || sample_opt == 2) {
+            perm.resize(data_num);
+            std::iota(perm.begin(), perm.end(), 0);
+            pos = data_num;
+        } else if (sample_opt == 3) {
+            if (block_size <= 0 || block_size > data_num) {
+                block_size = data_num;
+            }
+            int num_block = (data_num + block_size - 1) / block_size;
+            block_perm.resize(num_block);
+            std::iota(block_perm.begin(), block_perm.end(), 0);
+            perm.resize(block_size);
+            block_pos = num_block;
+            pos = block_end = 0;
+        }
+    }
+
+    inline int next() {
+        if (focused && uniform_real(gen) < focus_prob) {
+            return focus_begin + bounded_rand(gen, data_num - focus_begin);
+        }
+        switch (sample_opt) {
+        case 1:
+            if (pos == data_num) {
+                VRSGD::shuffle(perm.begin(), perm.end(), gen);
+                pos = 0;
+            }
+            return perm[pos++];
+        case 2:
+            if (pos == data_num) {
+                pos = 0;
+            }
+            return perm[pos++];
+        case 3:
+            if (pos == block_end) {
+                next_block();
+            }
+            return perm[pos++];
+        case 4:
+            return alias_table(gen);
+        default:
+            return bounded_rand(gen, data_num);
+        }
+    }
+
+    inline bool is_weighted() const { return sample_opt == 4 || focused; }
+
+    inline double weight(int idx) const {
+        if (focused) {
+            return idx < focus_begin ? old_weight : new_weight;
+        }
+        return sample_opt == 4 ? weights[idx] : 1.;
+    }
+
+    // Call before init(), prob in [0, 1)
+    void focus(int first_row, double prob) {
+        focus_begin = first_row;
+        focus_prob = prob;
+    }
+
+    // min_i n p_i of focus() over data_num rows, 1 without it. The weights
+    // scale the old rows' gradients by its inverse, so step sizes derived
+    // for uniform sampling must be multiplied by it.
+    double min_sample_ratio(int data_num) const {
+        if (focus_prob <= 0 || focus_begin <= 0 || focus_begin >= data_num || sample_opt == 4) {
+            return 1.;
+        }
+        return 1. - focus_prob;
+    }
+
+    inline RNG& get_gen() { return gen; }
+
+    inline int get_sample_opt() const { return sample_opt; }
+
+   private:
+    void next_block() {
+        if (block_pos == (int)block_perm.size()) {
+            VRSGD::shuffle(block_perm.begin(), block_perm.end(), gen);
+            block_pos = 0;
+        }
+
+        int start = block_perm[block_pos++] * block_size;
+        int len = std::min(block_size, data_num - start);
+        for (int i = 0; i < len; i++) {
+            perm[i] = start + i;
+        }
+        VRSGD::shuffle(perm.begin(), perm.begin() + len, gen);
+
+        pos = 0;
+        block_end = len;
+    }
+
+    int sample_opt;
+    int block_size;
+    int data_num = 0;
+    RNG gen;
+
+    AliasTable alias_table;
+    std::vector<double> weights;
+
+    std::vector<int> perm;
+    std::vector<int> block_perm;
+    int pos = 0;
+    int block_pos = 0;
+    int block_end = 0;
+
+    int focus_begin = 0;
+    double focus_prob = 0;
+    bool focused = false;
+    double old_weight = 1;
+    double new_weight = 1;
+};
+
+// With uniform sampling the step size is governed by max_i L_i, with
+// importance sampling (sample_opt 4) by the average, e.g. alpha = 1 / (3 avg_L)
+template <typename ProblemT>
+double max_smoothness(ProblemT& problem) {
+    double max_L = 0;
+    for (int i = 0; i < problem.size(); i++) {
+        max_L = std::max(max_L, problem.smoothness(i));
+    }
+    return max_L;
+}
+
+template <typename ProblemT>
+double avg_smoothness(ProblemT& problem) {
+    double sum_L = 0;
+    for (int i = 0; i < problem.size(); i++) {
+        sum_L += problem.smoothness(i);
+    }
+    return sum_L / problem.size();
+}
+
+// Number of rows whose features (and, with per_row_extra, e.g. a SAGA table
+// entry) fit into cache_bytes, to be used as the block size of sample_opt 3
+template <typename T, typename U, bool is_sparse>
+int cache_block_size(const std::vector<LabeledPoint<Vector<T, is_sparse>, U>>& data_points,
+                     std::size_t cache_bytes = 1 << 20, std::size_t per_row_extra = 0) {
+    if (data_points.empty()) {
+        return 1;
+    }
+
+    std::size_t total = 0;
+    for (const auto& data_point : data_points) {
+        if (is_sparse) {
+            total += std::distance(data_point.x.begin(), data_point.x.end()) * sizeof(FeaValPair<T>);
+        } else {
+            total += data_point.x.get_feature_num() * sizeof(T);
+        }
+    }
+
+    std::size_t row_bytes = total / data_points.size() + sizeof(LabeledPoint<Vector<T, is_sparse>, U>) + per_row_extra;
+    return std::max<std::size_t>(1, cache_bytes / row_bytes);
+}
+
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include "vector.hpp"
+#include "model.hpp"
+#include "utils.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace VRSGD {
+
+// Applies a trained Model to single rows. score() neither allocates nor
+// copies, so it can be called per request on a hot path.
+class Scorer {
+   public:
+    explicit Scorer(const Model& model)
+        : w(model.w), intercept(model.has_intercept()), logistic(model.problem == "logistic") {}
+
+    // <w, x>, plus the intercept if the model has one
+    template <typename T, bool is_sparse>
+    inline double margin(const Vector<T, is_sparse>& x) const {
+        return intercept ? w.dot_with_intcpt(x) : w.dot(x);
+    }
+
+    // The model's prediction: a probability for logistic regression, the
+    // margin otherwise
+    inline double predict(double margin) const { return logistic ? 1. / (1. + std::exp(-margin)) : margin; }
+
+    template <typename T, bool is_sparse>
+    inline double score(const Vector<T, is_sparse>& x) const {
+        return predict(margin(x));
+    }
+
+   private:
+    const DenseVector<double>& w;
+    bool intercept;
+    bool logistic;
+};
+
+/*
+ * Streaming evaluation metrics, mergeable across threads and batches so that
+ * nothing per row has to be kept.
+ *
+ * Labels > 0 are positives. A row is classified positive if its margin is
+ * >= 0. AUC is computed from histograms of sigmoid(margin) with num_bin bins,
+ * rows falling into the same bin count as ties.
+ */
+class Metrics {
+   public:
+    explicit Metrics(int num_bin = 1 << 18) : pos_hist(num_bin), neg_hist(num_bin) {}
+
+    inline void add(double margin, double prediction, double label) {
+        double err = prediction - label;
+        sum_sqr_err += err * err;
+        num++;
+
+        bool positive = label > 0;
+        num_correct += (margin >= 0) == positive;
+
+        int bin = std::min<int>(pos_hist.size() - 1, pos_hist.size() / (1. + std::exp(-margin)));
+        if (positive) {
+            pos_hist[bin]++;
+        } else {
+            neg_hist[bin]++;
+        }
+    }
+
+    void merge(const Metrics& b) {
+        sum_sqr_err += b.sum_sqr_err;
+        num += b.num;
+        num_correct += b.num_correct;
+        for (std::size_t i = 0; i < pos_hist.size(); i++) {
+            pos_hist[i] += b.pos_hist[i];
+            neg_hist[i] += b.neg_hist[i];
+        }
+    }
+
+    inline long long size() const { return num; }
+
+    inline double rmse() const { return std::sqrt(sum_sqr_err / num); }
+
+    inline double accuracy() const { return (double)num_correct / num; }
+
+    double auc() const {
+        // Probability that a random positive outranks a random negative
+        double num_neg_below = 0, area = 0, num_pos = 0;
+        for (std::size_t i = 0; i < pos_hist.size(); i++) {
+            area += pos_hist[i] * (num_neg_below + neg_hist[i] / 2.);
+            num_neg_below += neg_hist[i];
+            num_pos += pos_hist[i];
+        }
+        return area / (num_pos * num_neg_below);
+    }
+
+   private:
+    double sum_sqr_err = 0;
+    long long num = 0;
+    long long num_correct = 0;
+    std::vector<uint64_t> pos_hist;
+    std::vector<uint64_t> neg_hist;
+};
+
+/*
+ * Scores a batch of rows on num_threads threads, a row-partitioned sparse
+ * matrix-vector product. scores[i] receives the prediction for
+ * data_points[i], and thread t accumulates its rows into metrics[t].
+ */
+template <typename T, typename U, bool is_sparse>
+void score_batch(const Scorer& scorer, const std::vector<LabeledPoint<Vector<T, is_sparse>, U>>& data_points,
+                 std::vector<double>& scores, std::vector<Metrics>& metrics, int num_threads) {
+    scores.resize(data_points.size());
+    parallel_for(data_points.size(), num_threads, [&](int begin, int end, int thread_id) {
+        Metrics& local = metrics[thread_id];
+        for (int i = begin; i < end; i++) {
+            double margin = scorer.margin(data_points[i].x);
+            scores[i] = scorer.predict(margin);
+            local.add(margin, scores[i], data_points[i].y);
+        }
+    });
+}
+
+}
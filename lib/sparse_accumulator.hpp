@@ -0,0 +1,89 @@
+#pragma once
+
+#include "vector.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace VRSGD {
+
+/*
+ * Sum of sparse vectors over feature_num features: a dense scratch of the
+ * values, a bitmap of the touched features and the list of their indices.
+ * Adding a vector costs its nnz, and clear() and apply() only visit the
+ * touched features, so a mini-batch update costs the nnz of the batch
+ * instead of feature_num per row. Once a dense vector is added all features
+ * count as touched and the loops run over the plain array.
+ */
+template <typename T>
+class SparseAccumulator {
+   public:
+    explicit SparseAccumulator(int feature_num) : vals(feature_num), touched(feature_num, 0) {}
+
+    // this += c * x
+    void add(const DenseVector<T>& x, T c) {
+        dense = true;
+        for (int fea = 0; fea < x.get_feature_num(); fea++) {
+            vals[fea] += c * x[fea];
+        }
+    }
+
+    void add(const SparseVector<T>& x, T c) {
+        if (dense) {
+            for (auto it = x.begin_feaval(); it != x.end_feaval(); ++it) {
+                const auto& entry = *it;
+                vals[entry.fea] += c * entry.val;
+            }
+            return;
+        }
+        for (auto it = x.begin_feaval(); it != x.end_feaval(); ++it) {
+            const auto& entry = *it;
+            if (!touched[entry.fea]) {
+                touched[entry.fea] = 1;
+                indices.push_back(entry.fea);
+            }
+            vals[entry.fea] += c * entry.val;
+        }
+    }
+
+    // out += c * this, the touched features in increasing order
+    void apply(DenseVector<T>& out, T c) {
+        if (dense) {
+            for (std::size_t fea = 0; fea < vals.size(); fea++) {
+                out[fea] += c * vals[fea];
+            }
+            return;
+        }
+        std::sort(indices.begin(), indices.end());
+        for (int fea : indices) {
+            out[fea] += c * vals[fea];
+        }
+    }
+
+    void clear() {
+        if (dense) {
+            std::fill(vals.begin(), vals.end(), 0);
+            std::fill(touched.begin(), touched.end(), 0);
+            indices.clear();
+            dense = false;
+            return;
+        }
+        for (int fea : indices) {
+            vals[fea] = 0;
+            touched[fea] = 0;
+        }
+        indices.clear();
+    }
+
+    inline int get_nnz() const { return dense ? vals.size() : indices.size(); }
+
+    inline T operator[](int fea) const { return vals[fea]; }
+
+   private:
+    std::vector<T> vals;
+    std::vector<char> touched;
+    std::vector<int> indices;
+    bool dense = false;
+};
+
+}
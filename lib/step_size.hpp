@@ -0,0 +1,103 @@
+#pragma once
+
+#include "vector.hpp"
+#include "random.hpp"
+#include "sampler.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace VRSGD {
+
+/*
+ * Step size strategies for the solvers in algo/, so that alpha does not have
+ * to be tuned per dataset.
+ */
+
+// 1 / (3 L), the step of the SAGA and SVRG analyses, from one pass over the
+// per-row smoothness. Importance sampling (sample_opt 4) is governed by the
+// average L_i instead of the largest one.
+template <typename ProblemT>
+double smoothness_step(ProblemT& problem, int sample_opt = 0) {
+    return sample_opt == 4 ? 1. / (3. * avg_smoothness(problem)) : 1. / (3. * max_smoothness(problem));
+}
+
+/*
+ * Barzilai-Borwein step for SVRG (SVRG-BB, Tan et al. 2016). After every
+ * snapshot,
+ *   alpha = ||w_tidle - w_tidle_prev||^2 / (m <w_tidle - w_tidle_prev, mu_tidle - mu_tidle_prev>)
+ * where m is the number of inner iterations. The first snapshot has no
+ * predecessor and keeps the initial alpha, as does a non-positive curvature.
+ */
+template <typename T>
+class BBStep {
+   public:
+    explicit BBStep(double alpha) : alpha(alpha) {}
+
+    double next(const DenseVector<T>& w_tidle, const DenseVector<T>& mu_tidle, int num_inner_iter) {
+        if (has_prev) {
+            DenseVector<T> s = w_tidle - w_prev;
+            double curvature = s.dot(mu_tidle - mu_prev);
+            if (curvature > 0) {
+                alpha = s.norm_sqr() / (num_inner_iter * curvature);
+            }
+        }
+        w_prev = w_tidle;
+        mu_prev = mu_tidle;
+        has_prev = true;
+
+        return alpha;
+    }
+
+   private:
+    double alpha;
+    bool has_prev = false;
+    DenseVector<T> w_prev;
+    DenseVector<T> mu_prev;
+};
+
+/*
+ * Backtracking line search on the objectives of sample_size random rows.
+ * Starting from alpha, the step is multiplied by shrink until a gradient
+ * step satisfies the sufficient decrease condition
+ *   f_i(w - step g_i) <= f_i(w) - step / 2 ||g_i||^2
+ * for every sampled row i, where f_i is loss_func(., i). The accepted step
+ * estimates 1 / max L_i over the sample, without knowing the L_i;
+ * variance-reduced solvers should use a third of it.
+ *
+ * @param alpha
+ * first step tried, <= 0: 4 / (average smoothness of the sample)
+ */
+template <typename T, typename ProblemT, typename RNG>
+double backtracking_step(ProblemT& problem, const DenseVector<T>& w, double alpha, int sample_size, RNG& gen,
+                         double shrink = 0.5, int max_trial = 50) {
+    int data_num = problem.size();
+    sample_size = std::min(sample_size, data_num);
+
+    std::vector<int> rows(sample_size);
+    double sum_L = 0;
+    for (auto& row : rows) {
+        row = bounded_rand(gen, data_num);
+        sum_L += problem.smoothness(row);
+    }
+    if (alpha <= 0) {
+        alpha = 4. * sample_size / sum_L;
+    }
+
+    int num_trial = 0;
+    for (int row : rows) {
+        DenseVector<T> grad = problem.grad_func(w, row);
+        double loss = problem.loss_func(w, row);
+        double grad_norm_sqr = grad.norm_sqr();
+
+        while (num_trial < max_trial &&
+               problem.loss_func(w - alpha * grad, row) > loss - alpha / 2. * grad_norm_sqr) {
+            alpha *= shrink;
+            num_trial++;
+        }
+    }
+
+    return alpha;
+}
+
+}
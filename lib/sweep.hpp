@@ -0,0 +1,104 @@
+#pragma once
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace VRSGD {
+
+/*
+ * Early termination for a sweep of concurrent training jobs, asynchronous
+ * successive halving (Li et al., ASHA). Rung k sits at min_epochs * eta^k
+ * epochs. A job reaching a rung records its objective there and goes on only
+ * if it is in the best 1 / eta of the jobs of its group that reached the
+ * rung so far, so about 1 / eta^k of the jobs run past rung k and no job
+ * waits for another. A job whose objective is not finite or grew past
+ * diverge_ratio times its first one is stopped at once.
+ *
+ * Only jobs of the same group are compared, e.g. those with the same lambda,
+ * whose objectives are the same function.
+ */
+class SuccessiveHalving {
+   public:
+    SuccessiveHalving(int num_jobs, int num_groups, double min_epochs, double eta, double diverge_ratio = 10)
+        : rungs(num_groups), next_rung(num_jobs, 0), first_cost(num_jobs, NAN), min_epochs(min_epochs), eta(eta),
+          diverge_ratio(diverge_ratio) {}
+
+    /*
+     * Called by job after epochs passes over the data with its objective.
+     *
+     * @return false if the job should stop
+     */
+    bool report(int job, int group, double epochs, double cost) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (std::isnan(first_cost[job])) {
+            first_cost[job] = cost;
+        }
+        if (!std::isfinite(cost) || cost > diverge_ratio * std::abs(first_cost[job])) {
+            return false;
+        }
+
+        // The highest rung passed since the last report
+        int rung = -1;
+        while (epochs >= rung_epochs(next_rung[job])) {
+            rung = next_rung[job]++;
+        }
+        if (rung < 0) {
+            return true;
+        }
+
+        auto& group_rungs = rungs[group];
+        if ((int)group_rungs.size() <= rung) {
+            group_rungs.resize(rung + 1);
+        }
+        auto& costs = group_rungs[rung];
+        costs.push_back(cost);
+
+        std::size_t rank = std::count_if(costs.begin(), costs.end(), [&](double c) { return c < cost; });
+        return rank < std::ceil(costs.size() / eta);
+    }
+
+    inline double rung_epochs(int rung) const { return min_epochs * std::pow(eta, rung); }
+
+   private:
+    std::mutex mutex;
+    std::vector<std::vector<std::vector<double>>> rungs;
+    std::vector<int> next_rung;
+    std::vector<double> first_cost;
+    double min_epochs;
+    double eta;
+    double diverge_ratio;
+};
+
+// Bytes of memory available to new allocations, from /proc/meminfo
+inline std::size_t available_memory() {
+    std::ifstream fs("/proc/meminfo");
+    std::string key;
+    std::size_t kb;
+    std::string unit;
+    while (fs >> key >> kb >> unit) {
+        if (key == "MemAvailable:") {
+            return kb << 10;
+        }
+    }
+    return (std::size_t)sysconf(_SC_AVPHYS_PAGES) * sysconf(_SC_PAGESIZE);
+}
+
+// Number of concurrent jobs of job_bytes each that fit into the cores and
+// into memory_fraction of the available memory, at most max_jobs and at least 1
+inline int fit_num_jobs(int max_jobs, std::size_t job_bytes, double memory_fraction = 0.8) {
+    int num = std::max(1u, std::thread::hardware_concurrency());
+    if (job_bytes > 0) {
+        num = std::min<double>(num, memory_fraction * available_memory() / job_bytes);
+    }
+    return std::max(1, std::min(num, max_jobs));
+}
+
+}
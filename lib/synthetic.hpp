@@ -0,0 +1,108 @@
+#pragma once
+
+#include "vector.hpp"
+#include "random.hpp"
+
+#include <cmath>
+#include <vector>
+
+namespace VRSGD {
+
+/*
+ * Synthetic datasets with controllable shape, for benchmarking without the
+ * real datasets at hand. Every row has on average density * feature_num
+ * nonzeros drawn from N(0, 1) and is normalized to unit length, labels come
+ * from a hidden dense model w_star.
+ *
+ * @param label_opt
+ * 0: regression, y = <w_star, x> + noise * N(0, 1)
+ * 1: classification, y = sign(<w_star, x> + noise * N(0, 1)) in {-1, 1}
+ * 2: classification, as 1 but with labels in {0, 1}
+ *
+ * @param row_seed
+ * 0: the rows are drawn after w_star from seed. Otherwise w_star still comes
+ * from seed and the rows from row_seed, e.g. rows appended to a dataset that
+ * follow the same hidden model
+ */
+
+template <typename RNG>
+inline double normal_rand(RNG& gen) {
+    // Box-Muller, the second variate is dropped to keep the generator stateless
+    double u1 = 1. - uniform_real(gen);
+    double u2 = uniform_real(gen);
+    return std::sqrt(-2. * std::log(u1)) * std::cos(2. * M_PI * u2);
+}
+
+template <typename T, typename U, bool is_sparse>
+void make_synthetic(std::vector<LabeledPoint<Vector<T, is_sparse>, U>>& data_points, int data_num, int feature_num,
+                    double density, double noise, int label_opt, uint64_t seed, uint64_t row_seed = 0) {
+    Xoshiro256 model_gen(seed);
+
+    std::vector<double> w_star(feature_num);
+    for (auto& val : w_star) {
+        val = normal_rand(model_gen);
+    }
+    Xoshiro256 row_gen(row_seed);
+    Xoshiro256& gen = row_seed != 0 ? row_gen : model_gen;
+
+    // Skip over features geometrically so a row costs O(nnz) rather than O(feature_num)
+    double log_q = density < 1 ? std::log1p(-density) : 0;
+    std::vector<int> feas;
+    std::vector<T> vals;
+
+    data_points.reserve(data_points.size() + data_num);
+    for (int i = 0; i < data_num; i++) {
+        feas.clear();
+        vals.clear();
+
+        int fea = -1;
+        while (true) {
+            if (density >= 1) {
+                fea++;
+            } else {
+                // Compared in double, the skip is inf or nan for a density near 0
+                double skip = std::log(1. - uniform_real(gen)) / log_q;
+                if (!(skip < feature_num - 1 - fea)) {
+                    break;
+                }
+                fea += 1 + (int)skip;
+            }
+            if (fea >= feature_num) {
+                break;
+            }
+            feas.push_back(fea);
+            vals.push_back(normal_rand(gen));
+        }
+        if (feas.empty()) {
+            feas.push_back(bounded_rand(gen, feature_num));
+            vals.push_back(1);
+        }
+
+        double norm_sqr = 0;
+        for (T val : vals) {
+            norm_sqr += val * val;
+        }
+        double norm = std::sqrt(norm_sqr);
+
+        Vector<T, is_sparse> x(feature_num);
+        double margin = 0;
+        for (int j = 0; j < (int)feas.size(); j++) {
+            x.set(feas[j], vals[j] / norm);
+            margin += w_star[feas[j]] * vals[j] / norm;
+        }
+        margin += noise * normal_rand(gen);
+
+        U y;
+        if (label_opt == 0) {
+            y = margin;
+        } else if (label_opt == 1) {
+            y = margin >= 0 ? 1 : -1;
+        } else {
+            y = margin >= 0 ? 1 : 0;
+        }
+
+        data_points.emplace_back(std::move(x), std::move(y));
+    }
+}
+
+}
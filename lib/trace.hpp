@@ -0,0 +1,303 @@
+#pragma once
+
+// Phase tracing for the solver iterations. Compile with -DVRSGD_TRACE to time
+// the phases marked by VRSGD_TRACE_SCOPE and VRSGD_TRACED, optionally with
+// perf_event_open counters per phase, and to export them as a per-phase
+// summary or a Chrome trace (chrome://tracing, Perfetto); without it the
+// macros expand to nothing and to the plain expression.
+
+#ifdef VRSGD_TRACE
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace VRSGD {
+
+enum TracePhase {
+    PHASE_FULL_GRAD,  // svrg snapshot, saga table
+    PHASE_GRAD,       // grad_func of the sampled rows
+    PHASE_UPDATE,     // variance-reduction arithmetic
+    PHASE_PROX,
+    PHASE_COST,
+    NUM_TRACE_PHASE
+};
+
+static const char* const trace_phase_names[NUM_TRACE_PHASE] = {"full_grad", "grad", "update", "prox", "cost"};
+
+enum PerfCounter {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_CACHE_MISSES,
+    NUM_PERF_COUNTER
+};
+
+static const char* const perf_counter_names[NUM_PERF_COUNTER] = {"cycles", "instructions", "cache_misses"};
+
+// Set before the traced threads start
+struct TraceConfig {
+    bool perf = false;          // perf_event_open counters, costs a read() per scope
+    std::size_t max_events = 0; // events kept per thread for write_chrome_trace()
+};
+
+inline TraceConfig& trace_config() {
+    static TraceConfig config;
+    return config;
+}
+
+/*
+ * User-space cycles, instructions and cache misses of the calling thread, as
+ * one perf_event_open group read with a single read(). ok() is false where
+ * the kernel refuses them, e.g. perf_event_paranoid > 2 or in a container,
+ * and read() then yields zeros.
+ */
+class PerfCounters {
+   public:
+    PerfCounters() {
+        static const uint64_t configs[NUM_PERF_COUNTER] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                                           PERF_COUNT_HW_CACHE_MISSES};
+        for (int c = 0; c < NUM_PERF_COUNTER; c++) {
+            perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = configs[c];
+            attr.disabled = c == 0;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP;
+            fds[c] = syscall(__NR_perf_event_open, &attr, 0, -1, c == 0 ? -1 : fds[0], 0);
+            if (fds[c] < 0) {
+                close_all();
+                return;
+            }
+        }
+        ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+
+    ~PerfCounters() { close_all(); }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    inline bool ok() const { return fds[0] >= 0; }
+
+    inline void read(uint64_t* values) const {
+        uint64_t buf[1 + NUM_PERF_COUNTER];
+        if (!ok() || ::read(fds[0], buf, sizeof(buf)) != sizeof(buf)) {
+            memset(values, 0, NUM_PERF_COUNTER * sizeof(uint64_t));
+            return;
+        }
+        memcpy(values, buf + 1, NUM_PERF_COUNTER * sizeof(uint64_t));
+    }
+
+   private:
+    void close_all() {
+        for (int& fd : fds) {
+            if (fd >= 0) {
+                close(fd);
+            }
+            fd = -1;
+        }
+    }
+
+    int fds[NUM_PERF_COUNTER] = {-1, -1, -1};
+};
+
+struct TraceEvent {
+    int phase;
+    int64_t start_ns;
+    int64_t dur_ns;
+    uint64_t counters[NUM_PERF_COUNTER];
+};
+
+// Per-phase totals and events of one thread
+struct ThreadTrace {
+    int tid;
+    long long calls[NUM_TRACE_PHASE] = {};
+    int64_t ns[NUM_TRACE_PHASE] = {};
+    uint64_t counters[NUM_TRACE_PHASE][NUM_PERF_COUNTER] = {};
+    std::vector<TraceEvent> events;
+    std::unique_ptr<PerfCounters> perf;
+};
+
+// All threads that traced something; they stay here after the threads exit
+struct TraceRegistry {
+    std::mutex mutex;
+    std::vector<std::shared_ptr<ThreadTrace>> threads;
+};
+
+inline TraceRegistry& trace_registry() {
+    static TraceRegistry registry;
+    return registry;
+}
+
+inline ThreadTrace& thread_trace() {
+    static thread_local std::shared_ptr<ThreadTrace> trace;
+    if (!trace) {
+        trace = std::make_shared<ThreadTrace>();
+        if (trace_config().perf) {
+            trace->perf.reset(new PerfCounters());
+        }
+        trace->events.reserve(trace_config().max_events);
+
+        TraceRegistry& registry = trace_registry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        trace->tid = registry.threads.size();
+        registry.threads.push_back(trace);
+    }
+    return *trace;
+}
+
+inline int64_t trace_now_ns() {
+    static const auto epoch = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+class TraceScope {
+   public:
+    explicit TraceScope(TracePhase phase) : trace(thread_trace()), phase(phase) {
+        if (trace.perf) {
+            trace.perf->read(start_counters);
+        }
+        start_ns = trace_now_ns();
+    }
+
+    ~TraceScope() {
+        int64_t dur_ns = trace_now_ns() - start_ns;
+        uint64_t counters[NUM_PERF_COUNTER] = {};
+        if (trace.perf) {
+            trace.perf->read(counters);
+            for (int c = 0; c < NUM_PERF_COUNTER; c++) {
+                counters[c] -= start_counters[c];
+                trace.counters[phase][c] += counters[c];
+            }
+        }
+        trace.calls[phase]++;
+        trace.ns[phase] += dur_ns;
+        if (trace.events.size() < trace_config().max_events) {
+            trace.events.push_back({phase, start_ns, dur_ns, {counters[0], counters[1], counters[2]}});
+        }
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+   private:
+    ThreadTrace& trace;
+    TracePhase phase;
+    int64_t start_ns;
+    uint64_t start_counters[NUM_PERF_COUNTER] = {};
+};
+
+template <typename F>
+inline auto traced(TracePhase phase, F f) -> decltype(f()) {
+    TraceScope scope(phase);
+    return f();
+}
+
+// Forgets everything traced so far, call while no thread is tracing
+inline void reset_trace() {
+    TraceRegistry& registry = trace_registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for (auto& trace : registry.threads) {
+        auto tid = trace->tid;
+        auto perf = std::move(trace->perf);
+        trace->events.clear();
+        *trace = ThreadTrace();
+        trace->tid = tid;
+        trace->perf = std::move(perf);
+    }
+}
+
+// One JSON object per phase with its calls, seconds and counters summed over
+// all threads
+inline void print_trace_summary(FILE* out) {
+    TraceRegistry& registry = trace_registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    bool perf = false;
+    for (const auto& trace : registry.threads) {
+        perf = perf || (trace->perf && trace->perf->ok());
+    }
+    for (int phase = 0; phase < NUM_TRACE_PHASE; phase++) {
+        long long calls = 0;
+        int64_t ns = 0;
+        uint64_t counters[NUM_PERF_COUNTER] = {};
+        for (const auto& trace : registry.threads) {
+            calls += trace->calls[phase];
+            ns += trace->ns[phase];
+            for (int c = 0; c < NUM_PERF_COUNTER; c++) {
+                counters[c] += trace->counters[phase][c];
+            }
+        }
+        fprintf(out, "{\"phase\": \"%s\", \"calls\": %lld, \"seconds\": %.6f", trace_phase_names[phase], calls,
+                ns * 1e-9);
+        if (perf) {
+            for (int c = 0; c < NUM_PERF_COUNTER; c++) {
+                fprintf(out, ", \"%s\": %llu", perf_counter_names[c], (unsigned long long)counters[c]);
+            }
+        }
+        fprintf(out, "}\n");
+    }
+}
+
+// Chrome trace event format: one complete event per kept scope, the counters
+// in its args
+inline bool write_chrome_trace(const char* filename) {
+    FILE* out = fopen(filename, "w");
+    if (!out) {
+        return false;
+    }
+    TraceRegistry& registry = trace_registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    fprintf(out, "{\"traceEvents\": [");
+    const char* sep = "\n";
+    for (const auto& trace : registry.threads) {
+        bool perf = trace->perf && trace->perf->ok();
+        for (const auto& event : trace->events) {
+            fprintf(out, "%s{\"name\": \"%s\", \"cat\": \"vrsgd\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, "
+                         "\"ts\": %.3f, \"dur\": %.3f",
+                    sep, trace_phase_names[event.phase], trace->tid, event.start_ns * 1e-3, event.dur_ns * 1e-3);
+            if (perf) {
+                fprintf(out, ", \"args\": {\"cycles\": %llu, \"instructions\": %llu, \"cache_misses\": %llu}",
+                        (unsigned long long)event.counters[PERF_CYCLES],
+                        (unsigned long long)event.counters[PERF_INSTRUCTIONS],
+                        (unsigned long long)event.counters[PERF_CACHE_MISSES]);
+            }
+            fprintf(out, "}");
+            sep = ",\n";
+        }
+    }
+    fprintf(out, "\n], \"displayTimeUnit\": \"ns\"}\n");
+    return fclose(out) == 0;
+}
+
+}
+
+#define VRSGD_TRACE_CONCAT_(a, b) a##b
+#define VRSGD_TRACE_CONCAT(a, b) VRSGD_TRACE_CONCAT_(a, b)
+
+// Times the rest of the enclosing block as phase
+#define VRSGD_TRACE_SCOPE(phase) VRSGD::TraceScope VRSGD_TRACE_CONCAT(trace_scope_, __LINE__)(VRSGD::phase)
+
+// Value of expr, timed as phase
+#define VRSGD_TRACED(phase, expr) VRSGD::traced(VRSGD::phase, [&] { return expr; })
+
+#else
+
+#define VRSGD_TRACE_SCOPE(phase) \
+    do {                         \
+    } while (0)
+
+#define VRSGD_TRACED(phase, expr) (expr)
+
+#endif
@@ -0,0 +1,255 @@
+#pragma once
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace VRSGD {
+
+/*
+ * Transports connect the workers of a distributed solver. Like the problem
+ * classes they are duck-typed, a transport provides
+ *   int rank(), int size()
+ *   void allreduce_sum(double* data, int num): element-wise sum over all
+ *     workers, the result is left in data on every worker
+ */
+
+// Workers are threads of one process and reduce through shared memory
+class LocalGroup {
+   public:
+    explicit LocalGroup(int size) : size(size) {}
+
+   private:
+    friend class LocalTransport;
+
+    int size;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<double> buffer;
+    std::vector<double> result;
+    int arrived = 0;
+    long long generation = 0;
+};
+
+class LocalTransport {
+   public:
+    LocalTransport(LocalGroup& group, int rank) : group(group), rank_(rank) {}
+
+    inline int rank() const { return rank_; }
+
+    inline int size() const { return group.size; }
+
+    void allreduce_sum(double* data, int num) {
+        std::unique_lock<std::mutex> lock(group.mutex);
+
+        if (group.arrived == 0) {
+            group.buffer.assign(num, 0);
+        }
+        for (int i = 0; i < num; i++) {
+            group.buffer[i] += data[i];
+        }
+
+        if (++group.arrived == group.size) {
+            group.arrived = 0;
+            group.result.swap(group.buffer);
+            group.generation++;
+            group.cv.notify_all();
+        } else {
+            long long generation = group.generation;
+            group.cv.wait(lock, [&]() { return group.generation != generation; });
+        }
+
+        // The next round cannot complete before every worker got here, so
+        // result stays valid while it is read
+        std::memcpy(data, group.result.data(), num * sizeof(double));
+    }
+
+   private:
+    LocalGroup& group;
+    int rank_;
+};
+
+// Workers are processes connected over TCP in a star: rank 0 accepts a
+// connection from every other rank, sums their contributions and sends the
+// result back. Rank 0 listens on host only, loopback by default, since the
+// connections are not authenticated
+class SocketTransport {
+   public:
+    SocketTransport(int rank, int size, int port, const std::string& host = "127.0.0.1") : rank_(rank), size_(size) {
+        sockaddr_in addr = make_addr(host, port);
+        if (rank == 0) {
+            int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+            if (listen_fd < 0) {
+                throw std::runtime_error(std::string("SocketTransport: socket failed: ") + std::strerror(errno));
+            }
+            int one = 1;
+            setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+            if (bind(listen_fd, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listen_fd, size) != 0) {
+                close(listen_fd);
+                throw std::runtime_error("SocketTransport: cannot listen on " + host + ":" + std::to_string(port));
+            }
+
+            peers.assign(size, -1);
+            try {
+                for (int i = 1; i < size; i++) {
+                    accept_peer(listen_fd);
+                }
+            } catch (...) {
+                // The destructor does not run for a throwing constructor
+                close(listen_fd);
+                close_all();
+                throw;
+            }
+            close(listen_fd);
+        } else {
+            // rank 0 may not be listening yet
+            for (int attempt = 0;; attempt++) {
+                root = socket(AF_INET, SOCK_STREAM, 0);
+                if (connect(root, (sockaddr*)&addr, sizeof(addr)) == 0) {
+                    break;
+                }
+                close(root);
+                if (attempt == 600) {
+                    throw std::runtime_error("SocketTransport: cannot connect to " + host + ":" + std::to_string(port));
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            }
+            set_nodelay(root);
+            int32_t my_rank = rank;
+            try {
+                write_all(root, &my_rank, sizeof(my_rank));
+            } catch (...) {
+                close_all();
+                throw;
+            }
+        }
+    }
+
+    SocketTransport(const SocketTransport&) = delete;
+    SocketTransport& operator=(const SocketTransport&) = delete;
+
+    ~SocketTransport() { close_all(); }
+
+    inline int rank() const { return rank_; }
+
+    inline int size() const { return size_; }
+
+    void allreduce_sum(double* data, int num) {
+        if (rank_ == 0) {
+            buffer.resize(num);
+            for (int i = 1; i < size_; i++) {
+                read_all(peers[i], buffer.data(), num * sizeof(double));
+                for (int j = 0; j < num; j++) {
+                    data[j] += buffer[j];
+                }
+            }
+            for (int i = 1; i < size_; i++) {
+                write_all(peers[i], data, num * sizeof(double));
+            }
+        } else {
+            write_all(root, data, num * sizeof(double));
+            read_all(root, data, num * sizeof(double));
+        }
+    }
+
+   private:
+    // Accepts one worker and files its connection under the rank it sends,
+    // which must be in [1, size) and not taken yet
+    void accept_peer(int listen_fd) {
+        int fd;
+        do {
+            fd = accept(listen_fd, nullptr, nullptr);
+        } while (fd < 0 && errno == EINTR);
+        if (fd < 0) {
+            throw std::runtime_error(std::string("SocketTransport: accept failed: ") + std::strerror(errno));
+        }
+
+        int32_t peer_rank = -1;
+        try {
+            read_all(fd, &peer_rank, sizeof(peer_rank));
+        } catch (...) {
+            close(fd);
+            throw;
+        }
+        if (peer_rank < 1 || peer_rank >= size_ || peers[peer_rank] >= 0) {
+            close(fd);
+            throw std::runtime_error("SocketTransport: unexpected rank " + std::to_string(peer_rank));
+        }
+        set_nodelay(fd);
+        peers[peer_rank] = fd;
+    }
+
+    void close_all() {
+        for (int& fd : peers) {
+            if (fd >= 0) {
+                close(fd);
+            }
+            fd = -1;
+        }
+        if (root >= 0) {
+            close(root);
+        }
+        root = -1;
+    }
+
+    static sockaddr_in make_addr(const std::string& host, int port) {
+        sockaddr_in addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        if (inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1) {
+            throw std::runtime_error("SocketTransport: not an IPv4 address: " + host);
+        }
+        return addr;
+    }
+
+    static void set_nodelay(int fd) {
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+
+    static void write_all(int fd, const void* data, std::size_t len) {
+        const char* p = (const char*)data;
+        while (len > 0) {
+            ssize_t n = write(fd, p, len);
+            if (n <= 0) {
+                throw std::runtime_error("SocketTransport: connection lost");
+            }
+            p += n;
+            len -= n;
+        }
+    }
+
+    static void read_all(int fd, void* data, std::size_t len) {
+        char* p = (char*)data;
+        while (len > 0) {
+            ssize_t n = read(fd, p, len);
+            if (n <= 0) {
+                throw std::runtime_error("SocketTransport: connection lost");
+            }
+            p += n;
+            len -= n;
+        }
+    }
+
+    int rank_;
+    int size_;
+    int root = -1;
+    std::vector<int> peers;
+    std::vector<double> buffer;
+};
+
+}
@@ -1,50 +1,338 @@
 #pragma once
 
 #include "vector.hpp"
+#include "random.hpp"
+#include "hashing.hpp"
 
 #include <boost/tokenizer.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
 #include <vector>
 #include <fstream>
+#include <functional>
 #include <string>
+#include <thread>
 
 namespace VRSGD {
 
+// Called by the solvers every sample_period iterations with the current
+// objective; returning false stops training early
+typedef std::function<bool(int, double)> ReportFunc;
+
+inline bool print_progress(int iter, double cost) {
+    printf("%d %.15f\n", iter, cost);
+    return true;
+}
+
+// Splits [0, num) into num_threads contiguous chunks and runs
+// func(begin, end, thread_id) on each of them concurrently
+template<typename Func>
+void parallel_for(int num, int num_threads, Func func) {
+    if (num_threads <= 1 || num < num_threads) {
+        func(0, num, 0);
+        return;
+    }
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; t++) {
+        int begin = (long long)num * t / num_threads;
+        int end = (long long)num * (t + 1) / num_threads;
+        threads.emplace_back(func, begin, end, t);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+// Runs func(task, thread_id) for every task in [0, num_tasks) on num_threads
+// threads, each thread taking the next task once it is done with its last,
+// for tasks of uneven cost such as training runs
+template<typename Func>
+void parallel_tasks(int num_tasks, int num_threads, Func func) {
+    std::atomic<int> next_task(0);
+    int num = std::max(1, std::min(num_threads, num_tasks));
+    parallel_for(num, num, [&](int, int, int thread_id) {
+        for (int task = next_task++; task < num_tasks; task = next_task++) {
+            func(task, thread_id);
+        }
+    });
+}
+
+/*
+ * Parses "y fea:val fea:val ..." with 1-based fea. Features outside
+ * [1, feature_num] are dropped, e.g. ids not seen in training when scoring.
+ *
+ * @param hasher
+ * if not null, the raw ids are mapped by hasher instead, feature_num must be
+ * hasher->num_buckets(); colliding features of the row are summed
+ */
+template<typename T, typename U, bool is_sparse>
+LabeledPoint<Vector<T, is_sparse>, U> parse_libsvm_line(const std::string& line, int feature_num, const FeatureHasher* hasher = nullptr) {
+    LabeledPoint<Vector<T, is_sparse>, U> data_point(Vector<T, is_sparse>(feature_num), 0);
+    std::vector<std::pair<int, double>> hashed;
+
+    boost::char_separator<char> sep(" \t");
+    boost::tokenizer<boost::char_separator<char>> tok(line, sep);
+
+    bool first_flag = true;
+    for (auto& w : tok) {
+        if (first_flag) {
+            data_point.y = std::stod(w);
+            first_flag = false;
+        } else {
+            boost::char_separator<char> sep2(":");
+            boost::tokenizer<boost::char_separator<char>> tok2(w, sep2);
+            auto it = tok2.begin();
+            std::string fea_str = *it;
+            it++;
+            double val = std::stod(*it);
+
+            if (hasher) {
+                double sign;
+                int fea = hasher->bucket(std::stoull(fea_str), sign);
+                hashed.emplace_back(fea, sign * val);
+                continue;
+            }
+
+            long long fea = std::stoll(fea_str) - 1;
+            if (fea >= 0 && fea < feature_num) {
+                data_point.x.set(fea, val);
+            }
+        }
+    }
+
+    if (hasher) {
+        std::sort(hashed.begin(), hashed.end(),
+                  [](const std::pair<int, double>& a, const std::pair<int, double>& b) { return a.first < b.first; });
+        for (std::size_t i = 0; i < hashed.size();) {
+            int fea = hashed[i].first;
+            double val = 0;
+            for (; i < hashed.size() && hashed[i].first == fea; i++) {
+                val += hashed[i].second;
+            }
+            data_point.x.set(fea, val);
+        }
+    }
+
+    return data_point;
+}
+
+// Largest 1-based feature index in libsvm formatted lines
+inline int libsvm_max_feature(const std::vector<std::string>& lines, int num_threads) {
+    std::vector<int> max_fea(std::max(num_threads, 1), 0);
+
+    parallel_for(lines.size(), num_threads, [&](int begin, int end, int thread_id) {
+        for (int i = begin; i < end; i++) {
+            const std::string& line = lines[i];
+            for (std::size_t pos = line.find(':'); pos != std::string::npos; pos = line.find(':', pos + 1)) {
+                std::size_t start = line.find_last_of(" \t", pos);
+                int fea = std::stoi(line.substr(start + 1, pos - start - 1));
+                max_fea[thread_id] = std::max(max_fea[thread_id], fea);
+            }
+        }
+    });
+
+    return *std::max_element(max_fea.begin(), max_fea.end());
+}
+
+/*
+ * @param feature_num
+ * number of features, or <= 0 to use the largest feature index in the file
+ *
+ * @param hasher
+ * hash the feature ids, see FeatureHasher; feature_num is then its number of
+ * buckets
+ *
+ * @param num_threads
+ * number of threads parsing the lines
+ *
+ * @return feature_num of the loaded rows
+ */
 template<typename T, typename U, bool is_sparse>
-void read_libsvm(std::vector<LabeledPoint<Vector<T, is_sparse>, U>>& data_points, std::string filename, int feature_num) {
+int read_libsvm(std::vector<LabeledPoint<Vector<T, is_sparse>, U>>& data_points, std::string filename, int feature_num, int num_threads = 1, const FeatureHasher* hasher = nullptr) {
     std::fstream fs(filename, std::fstream::in);
 
+    std::vector<std::string> lines;
     while (!fs.eof()) {
         std::string line;
         std::getline(fs, line);
         if (line == "") {
             continue;
         }
+        lines.push_back(std::move(line));
+    }
 
-        LabeledPoint<Vector<T, is_sparse>, U> data_point(Vector<T, is_sparse>(feature_num), 0);
-
-        boost::char_separator<char> sep(" \t");
-        boost::tokenizer<boost::char_separator<char>> tok(line, sep);
-        
-        bool first_flag = true;
-        for (auto& w : tok) {
-            if (first_flag) {
-                data_point.y = std::stod(w);
-                first_flag = false;
-            } else {
-                boost::char_separator<char> sep2(":");
-                boost::tokenizer<boost::char_separator<char>> tok2(w, sep2);
-                auto it = tok2.begin();
-                int fea = std::stoi(*it) - 1;
-                it++;
-                double val = std::stod(*it);
+    if (hasher) {
+        feature_num = hasher->num_buckets();
+    } else if (feature_num <= 0) {
+        feature_num = libsvm_max_feature(lines, num_threads);
+    }
 
+    std::size_t offset = data_points.size();
+    data_points.resize(offset + lines.size());
+    parallel_for(lines.size(), num_threads, [&](int begin, int end, int) {
+        for (int i = begin; i < end; i++) {
+            data_points[offset + i] = parse_libsvm_line<T, U, is_sparse>(lines[i], feature_num, hasher);
+        }
+    });
+
+    return feature_num;
+}
+
+/*
+ * Binary format, a dump of the parsed rows that loads without any text
+ * parsing:
+ * header: "VRSGDBIN" int32 is_sparse, int32 feature_num, int64 data_num
+ * row: double y, int32 nnz, nnz * (int32 fea, double val)
+ */
+template<typename T, typename U, bool is_sparse>
+void write_binary(const std::vector<LabeledPoint<Vector<T, is_sparse>, U>>& data_points, std::string filename) {
+    std::ofstream fs(filename, std::ofstream::binary);
+
+    int32_t sparse_flag = is_sparse;
+    int32_t feature_num = data_points.empty() ? 0 : data_points[0].x.get_feature_num();
+    int64_t data_num = data_points.size();
+    fs.write("VRSGDBIN", 8);
+    fs.write((const char*)&sparse_flag, sizeof(sparse_flag));
+    fs.write((const char*)&feature_num, sizeof(feature_num));
+    fs.write((const char*)&data_num, sizeof(data_num));
+
+    std::vector<int32_t> feas;
+    std::vector<double> vals;
+    for (const auto& data_point : data_points) {
+        feas.clear();
+        vals.clear();
+        for (auto it = data_point.x.begin_feaval(); it != data_point.x.end_feaval(); ++it) {
+            const auto& entry = *it;
+            if (entry.val != 0) {
+                feas.push_back(entry.fea);
+                vals.push_back(entry.val);
+            }
+        }
+
+        double y = data_point.y;
+        int32_t nnz = feas.size();
+        fs.write((const char*)&y, sizeof(y));
+        fs.write((const char*)&nnz, sizeof(nnz));
+        for (int32_t i = 0; i < nnz; i++) {
+            fs.write((const char*)&feas[i], sizeof(int32_t));
+            fs.write((const char*)&vals[i], sizeof(double));
+        }
+    }
+}
+
+// Reads a file in the binary format row by row, so that files larger than
+// memory can be processed in batches
+class BinaryReader {
+   public:
+    explicit BinaryReader(const std::string& filename) : fs(filename, std::ifstream::binary) {
+        char magic[8];
+        int32_t sparse_flag;
+        fs.read(magic, 8);
+        fs.read((char*)&sparse_flag, sizeof(sparse_flag));
+        fs.read((char*)&feature_num, sizeof(feature_num));
+        fs.read((char*)&data_num, sizeof(data_num));
+        if (!fs || std::string(magic, 8) != "VRSGDBIN" || feature_num < 0 || data_num < 0) {
+            feature_num = -1;
+            data_num = 0;
+        }
+    }
+
+    // -1 if the file is not in the binary format
+    inline int get_feature_num() const { return feature_num; }
+
+    inline int64_t get_data_num() const { return data_num; }
+
+    // Appends up to max_rows rows to data_points and returns how many were
+    // read, -1 if the file is truncated or a row is corrupt
+    template<typename T, typename U, bool is_sparse>
+    int next_batch(std::vector<LabeledPoint<Vector<T, is_sparse>, U>>& data_points, int64_t max_rows) {
+        int64_t num = std::min(max_rows, data_num - pos);
+        data_points.reserve(data_points.size() + std::min<int64_t>(num, 1 << 20));
+
+        for (int64_t i = 0; i < num; i++) {
+            double label;
+            int32_t nnz;
+            fs.read((char*)&label, sizeof(label));
+            fs.read((char*)&nnz, sizeof(nnz));
+            if (!fs || nnz < 0 || nnz > feature_num) {
+                return -1;
+            }
+
+            U y = label;
+            LabeledPoint<Vector<T, is_sparse>, U> data_point(Vector<T, is_sparse>(feature_num), std::move(y));
+            for (int32_t j = 0; j < nnz; j++) {
+                int32_t fea;
+                double val;
+                fs.read((char*)&fea, sizeof(fea));
+                fs.read((char*)&val, sizeof(val));
+                if (!fs || fea < 0 || fea >= feature_num) {
+                    return -1;
+                }
                 data_point.x.set(fea, val);
             }
+            data_points.push_back(std::move(data_point));
         }
 
-        data_points.push_back(std::move(data_point));
+        pos += num;
+        return num;
+    }
+
+   private:
+    std::ifstream fs;
+    int32_t feature_num;
+    int64_t data_num;
+    int64_t pos = 0;
+};
+
+// @return feature_num of the loaded rows, or -1 if filename is not in the
+// binary format or corrupt, data_points is then unchanged
+template<typename T, typename U, bool is_sparse>
+int read_binary(std::vector<LabeledPoint<Vector<T, is_sparse>, U>>& data_points, std::string filename) {
+    BinaryReader reader(filename);
+    if (reader.get_feature_num() < 0) {
+        return -1;
+    }
+    std::size_t offset = data_points.size();
+    if (reader.next_batch(data_points, reader.get_data_num()) < 0) {
+        data_points.erase(data_points.begin() + offset, data_points.end());
+        return -1;
+    }
+    return reader.get_feature_num();
+}
+
+// Reads up to max_rows nonempty lines of libsvm data from fs, parsing them on
+// num_threads threads, and returns how many rows were appended
+template<typename T, typename U, bool is_sparse>
+int read_libsvm_batch(std::istream& fs, std::vector<LabeledPoint<Vector<T, is_sparse>, U>>& data_points, int feature_num, int max_rows, int num_threads = 1, const FeatureHasher* hasher = nullptr) {
+    std::vector<std::string> lines;
+    std::string line;
+    while ((int)lines.size() < max_rows && std::getline(fs, line)) {
+        if (line != "") {
+            lines.push_back(std::move(line));
+        }
     }
+
+    std::size_t offset = data_points.size();
+    data_points.resize(offset + lines.size());
+    parallel_for(lines.size(), num_threads, [&](int begin, int end, int) {
+        for (int i = begin; i < end; i++) {
+            data_points[offset + i] = parse_libsvm_line<T, U, is_sparse>(lines[i], feature_num, hasher);
+        }
+    });
+
+    return lines.size();
+}
+
+// Physically permute the rows once so that cyclic or block sampling reads
+// them sequentially while still visiting them in a random order
+template<typename T, typename U, bool is_sparse>
+void shuffle_data_points(std::vector<LabeledPoint<Vector<T, is_sparse>, U>>& data_points, uint64_t seed) {
+    Xoshiro256 gen(seed);
+    VRSGD::shuffle(data_points.begin(), data_points.end(), gen);
 }
 
 }
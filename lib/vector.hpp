@@ -16,6 +16,10 @@
 
 #pragma once
 
+#include "allocator.hpp"
+#include "counters.hpp"
+
+#include <cassert>
 #include <cmath>
 #include <vector>
 
@@ -42,15 +46,16 @@ struct FeaValPair {
 template <typename T>
 class Vector<T, false> {
    public:
-    typedef typename std::vector<T>::iterator Iterator;
-    typedef typename std::vector<T>::const_iterator ConstIterator;
-    typedef typename std::vector<T>::iterator ValueIterator;
-    typedef typename std::vector<T>::const_iterator ConstValueIterator;
+    typedef std::vector<T, VectorAllocator<T>> Storage;
+    typedef typename Storage::iterator Iterator;
+    typedef typename Storage::const_iterator ConstIterator;
+    typedef typename Storage::iterator ValueIterator;
+    typedef typename Storage::const_iterator ConstValueIterator;
 
     class FeaValIterator {
        public:
-        explicit FeaValIterator(std::vector<T>& vec) : idx(0), vec(vec) {}
-        FeaValIterator(std::vector<T>& vec, int idx) : idx(idx), vec(vec) {}
+        explicit FeaValIterator(Storage& vec) : idx(0), vec(vec) {}
+        FeaValIterator(Storage& vec, int idx) : idx(idx), vec(vec) {}
 
         FeaValPair<T&> operator*() { return FeaValPair<T&>(idx, vec[idx]); }
 
@@ -82,13 +87,13 @@ class Vector<T, false> {
 
        private:
         int idx;
-        std::vector<T>& vec;
+        Storage& vec;
     };
 
     class ConstFeaValIterator {
        public:
-        explicit ConstFeaValIterator(const std::vector<T>& vec) : idx(0), vec(vec) {}
-        ConstFeaValIterator(const std::vector<T>& vec, int idx) : idx(idx), vec(vec) {}
+        explicit ConstFeaValIterator(const Storage& vec) : idx(0), vec(vec) {}
+        ConstFeaValIterator(const Storage& vec, int idx) : idx(idx), vec(vec) {}
 
         FeaValPair<const T&> operator*() const { return FeaValPair<const T&>(idx, vec[idx]); }
 
@@ -120,7 +125,7 @@ class Vector<T, false> {
 
        private:
         int idx;
-        const std::vector<T>& vec;
+        const Storage& vec;
     };
 
     Vector<T, false>() = default;
@@ -128,6 +133,7 @@ class Vector<T, false> {
     Vector<T, false>(int feature_num) : feature_num(feature_num), vec(feature_num) {}
 
     Vector<T, false>(const SparseVector<T>& b) : feature_num(b.get_feature_num()), vec(b.get_feature_num()) {
+        VRSGD_COUNT_TEMP(feature_num * sizeof(T));
         for (auto entry : b) {
             vec[entry.fea] = entry.val;
         }
@@ -139,6 +145,8 @@ class Vector<T, false> {
 
     inline int get_feature_num() const { return feature_num; }
 
+    inline int get_nnz() const { return feature_num; }
+
     inline Iterator begin() { return vec.begin(); }
 
     inline ConstIterator begin() const { return vec.begin(); }
@@ -199,6 +207,14 @@ class Vector<T, false> {
     DenseVector<T> operator-(const SparseVector<T>&) const;
     DenseVector<T>& operator-=(const SparseVector<T>&);
 
+    // this += c * b in place
+    DenseVector<T>& add_scaled(const DenseVector<T>& b, T c);
+    DenseVector<T>& add_scaled(const SparseVector<T>& b, T c);
+
+    // this += c * [b, 1], this has the trailing intercept entry, see dot_with_intcpt
+    DenseVector<T>& add_scaled_with_intcpt(const DenseVector<T>& b, T c);
+    DenseVector<T>& add_scaled_with_intcpt(const SparseVector<T>& b, T c);
+
     T dot(const DenseVector<T>&) const;
     T dot(const SparseVector<T>&) const;
 
@@ -220,23 +236,23 @@ class Vector<T, false> {
     }
 
    private:
-    std::vector<T> vec;
-    //T* vec;
+    Storage vec;
     int feature_num;
 };
 
 template <typename T>
 class Vector<T, true> {
    public:
-    typedef typename std::vector<FeaValPair<T>>::iterator Iterator;
-    typedef typename std::vector<FeaValPair<T>>::const_iterator ConstIterator;
-    typedef typename std::vector<FeaValPair<T>>::iterator FeaValIterator;
-    typedef typename std::vector<FeaValPair<T>>::const_iterator ConstFeaValIterator;
+    typedef std::vector<FeaValPair<T>, VectorAllocator<FeaValPair<T>>> Storage;
+    typedef typename Storage::iterator Iterator;
+    typedef typename Storage::const_iterator ConstIterator;
+    typedef typename Storage::iterator FeaValIterator;
+    typedef typename Storage::const_iterator ConstFeaValIterator;
 
     class ValueIterator {
        public:
-        explicit ValueIterator(std::vector<FeaValPair<T>>& vec) : idx(0), vec(vec) {}
-        ValueIterator(std::vector<FeaValPair<T>>& vec, int idx) : idx(idx), vec(vec) {}
+        explicit ValueIterator(Storage& vec) : idx(0), vec(vec) {}
+        ValueIterator(Storage& vec, int idx) : idx(idx), vec(vec) {}
 
         T& operator*() { return vec[idx].val; }
 
@@ -270,13 +286,13 @@ class Vector<T, true> {
 
        private:
         int idx;
-        std::vector<FeaValPair<T>>& vec;
+        Storage& vec;
     };
 
     class ConstValueIterator {
        public:
-        explicit ConstValueIterator(const std::vector<FeaValPair<T>>& vec) : idx(0), vec(vec) {}
-        ConstValueIterator(const std::vector<FeaValPair<T>>& vec, int idx) : idx(idx), vec(vec) {}
+        explicit ConstValueIterator(const Storage& vec) : idx(0), vec(vec) {}
+        ConstValueIterator(const Storage& vec, int idx) : idx(idx), vec(vec) {}
 
         const T& operator*() const { return vec[idx].val; }
 
@@ -310,7 +326,7 @@ class Vector<T, true> {
 
        private:
         int idx;
-        const std::vector<FeaValPair<T>>& vec;
+        const Storage& vec;
     };
 
     Vector<T, true>() = default;
@@ -319,6 +335,8 @@ class Vector<T, true> {
 
     inline int get_feature_num() const { return feature_num; }
 
+    inline int get_nnz() const { return vec.size(); }
+
     inline Iterator begin() { return vec.begin(); }
 
     inline ConstIterator begin() const { return vec.begin(); }
@@ -382,7 +400,11 @@ class Vector<T, true> {
     T dot_with_intcpt(const DenseVector<T>& b) const;
 
     inline T norm_sqr() const {
-        return (*this).dot(*this);
+        T res = 0;
+        for (const auto& entry : vec) {
+            res += entry.val * entry.val;
+        }
+        return res;
     }
 
     inline T norm() const {
@@ -396,7 +418,7 @@ class Vector<T, true> {
     }
 
    private:
-    std::vector<FeaValPair<T>> vec;
+    Storage vec;
     int feature_num;
 };
 
@@ -410,6 +432,20 @@ inline SparseVector<T> operator*(T c, const SparseVector<T>& a) {
     return a * c;
 }
 
+// c * [x, 1], the gradient of a row with intercept: a dense x is written into
+// one buffer by add_scaled_with_intcpt, a sparse one keeps its nnz + 1 entries
+template <typename T>
+inline DenseVector<T> scaled_with_intcpt(const DenseVector<T>& x, T c) {
+    DenseVector<T> res(x.get_feature_num() + 1);
+    res.add_scaled_with_intcpt(x, c);
+    return res;
+}
+
+template <typename T>
+inline SparseVector<T> scaled_with_intcpt(const SparseVector<T>& x, T c) {
+    return x.scalar_multiple_with_intcpt(c);
+}
+
 template <typename T, typename U>
 struct LabeledPoint {
     LabeledPoint() = default;
@@ -14,10 +14,11 @@
 //
 // (Originally written for this project by me and is later constributed into husky project)
 
-#include <cassert>
-
 template <typename T>
 DenseVector<T> DenseVector<T>::operator-() const {
+    VRSGD_COUNT_OP(OP_NEG, 2 * feature_num * sizeof(T));
+    VRSGD_COUNT_TEMP(feature_num * sizeof(T));
+
     DenseVector<T> res(*this);
 
     for (int i = 0; i < feature_num; i++) {
@@ -29,6 +30,9 @@ DenseVector<T> DenseVector<T>::operator-() const {
 
 template <typename T>
 DenseVector<T> DenseVector<T>::operator*(T c) const {
+    VRSGD_COUNT_OP(OP_SCALE, 2 * feature_num * sizeof(T));
+    VRSGD_COUNT_TEMP(feature_num * sizeof(T));
+
     DenseVector<T> res(feature_num);
 
     for (int i = 0; i < feature_num; i++) {
@@ -40,6 +44,9 @@ DenseVector<T> DenseVector<T>::operator*(T c) const {
 
 template <typename T>
 DenseVector<T> DenseVector<T>::scalar_multiple_with_intcpt(T c) const {
+    VRSGD_COUNT_OP(OP_INTCPT, 2 * feature_num * sizeof(T));
+    VRSGD_COUNT_TEMP((feature_num + 1) * sizeof(T));
+
     DenseVector<T> res(feature_num + 1);
 
     for (int i = 0; i < feature_num; i++) {
@@ -52,6 +59,8 @@ DenseVector<T> DenseVector<T>::scalar_multiple_with_intcpt(T c) const {
 
 template <typename T>
 DenseVector<T>& DenseVector<T>::operator*=(T c) {
+    VRSGD_COUNT_OP(OP_SCALE, 2 * feature_num * sizeof(T));
+
     for (int i = 0; i < feature_num; i++) {
         vec[i] *= c;
     }
@@ -61,6 +70,9 @@ DenseVector<T>& DenseVector<T>::operator*=(T c) {
 
 template <typename T>
 DenseVector<T> DenseVector<T>::operator/(T c) const {
+    VRSGD_COUNT_OP(OP_SCALE, 2 * feature_num * sizeof(T));
+    VRSGD_COUNT_TEMP(feature_num * sizeof(T));
+
     DenseVector<T> res(feature_num);
 
     for (int i = 0; i < feature_num; i++) {
@@ -72,6 +84,8 @@ DenseVector<T> DenseVector<T>::operator/(T c) const {
 
 template <typename T>
 DenseVector<T>& DenseVector<T>::operator/=(T c) {
+    VRSGD_COUNT_OP(OP_SCALE, 2 * feature_num * sizeof(T));
+
     for (int i = 0; i < feature_num; i++) {
         vec[i] /= c;
     }
@@ -81,6 +95,9 @@ DenseVector<T>& DenseVector<T>::operator/=(T c) {
 
 template <typename T>
 DenseVector<T> DenseVector<T>::operator+(const DenseVector<T>& b) const {
+    VRSGD_COUNT_OP(OP_ADD, 3 * feature_num * sizeof(T));
+    VRSGD_COUNT_TEMP(feature_num * sizeof(T));
+
     assert(feature_num == b.feature_num);
 
     DenseVector<T> res(feature_num);
@@ -94,6 +111,8 @@ DenseVector<T> DenseVector<T>::operator+(const DenseVector<T>& b) const {
 
 template <typename T>
 DenseVector<T>& DenseVector<T>::operator+=(const DenseVector<T>& b) {
+    VRSGD_COUNT_OP(OP_AXPY, 3 * feature_num * sizeof(T));
+
     assert(feature_num == b.feature_num);
 
     for (int i = 0; i < feature_num; i++) {
@@ -105,6 +124,9 @@ DenseVector<T>& DenseVector<T>::operator+=(const DenseVector<T>& b) {
 
 template <typename T>
 DenseVector<T> DenseVector<T>::operator+(const SparseVector<T>& b) const {
+    VRSGD_COUNT_OP(OP_ADD, 2 * feature_num * sizeof(T));
+    VRSGD_COUNT_TEMP(feature_num * sizeof(T));
+
     DenseVector<T> res(*this);
     res += b;
     return res;
@@ -112,6 +134,8 @@ DenseVector<T> DenseVector<T>::operator+(const SparseVector<T>& b) const {
 
 template <typename T>
 DenseVector<T>& DenseVector<T>::operator+=(const SparseVector<T>& b) {
+    VRSGD_COUNT_OP(OP_AXPY, b.get_nnz() * sizeof(FeaValPair<T>) + 2 * b.get_nnz() * sizeof(T));
+
     assert(feature_num == b.get_feature_num());
 
     for (const FeaValPair<T>& entry : b) {
@@ -123,6 +147,9 @@ DenseVector<T>& DenseVector<T>::operator+=(const SparseVector<T>& b) {
 
 template <typename T>
 DenseVector<T> DenseVector<T>::operator-(const DenseVector<T>& b) const {
+    VRSGD_COUNT_OP(OP_ADD, 3 * feature_num * sizeof(T));
+    VRSGD_COUNT_TEMP(feature_num * sizeof(T));
+
     assert(feature_num == b.feature_num);
 
     DenseVector<T> res(feature_num);
@@ -136,6 +163,8 @@ DenseVector<T> DenseVector<T>::operator-(const DenseVector<T>& b) const {
 
 template <typename T>
 DenseVector<T>& DenseVector<T>::operator-=(const DenseVector<T>& b) {
+    VRSGD_COUNT_OP(OP_AXPY, 3 * feature_num * sizeof(T));
+
     assert(feature_num == b.feature_num);
 
     for (int i = 0; i < feature_num; i++) {
@@ -147,6 +176,9 @@ DenseVector<T>& DenseVector<T>::operator-=(const DenseVector<T>& b) {
 
 template <typename T>
 DenseVector<T> DenseVector<T>::operator-(const SparseVector<T>& b) const {
+    VRSGD_COUNT_OP(OP_ADD, 2 * feature_num * sizeof(T));
+    VRSGD_COUNT_TEMP(feature_num * sizeof(T));
+
     DenseVector<T> res(*this);
     res -= b;
     return res;
@@ -154,6 +186,8 @@ DenseVector<T> DenseVector<T>::operator-(const SparseVector<T>& b) const {
 
 template <typename T>
 DenseVector<T>& DenseVector<T>::operator-=(const SparseVector<T>& b) {
+    VRSGD_COUNT_OP(OP_AXPY, b.get_nnz() * sizeof(FeaValPair<T>) + 2 * b.get_nnz() * sizeof(T));
+
     assert(feature_num == b.get_feature_num());
 
     for (auto it = b.begin_feaval(); it != b.end_feaval(); ++it) {
@@ -165,6 +199,8 @@ DenseVector<T>& DenseVector<T>::operator-=(const SparseVector<T>& b) {
 
 template <typename T>
 T DenseVector<T>::dot(const DenseVector<T>& b) const {
+    VRSGD_COUNT_OP(OP_DOT, 2 * feature_num * sizeof(T));
+
     assert(feature_num == b.feature_num);
 
     T res = 0;
@@ -178,6 +214,8 @@ T DenseVector<T>::dot(const DenseVector<T>& b) const {
 
 template <typename T>
 T DenseVector<T>::dot(const SparseVector<T>& b) const {
+    VRSGD_COUNT_OP(OP_DOT, b.get_nnz() * sizeof(FeaValPair<T>) + b.get_nnz() * sizeof(T));
+
     assert(feature_num == b.get_feature_num());
 
     T res = 0;
@@ -189,8 +227,64 @@ T DenseVector<T>::dot(const SparseVector<T>& b) const {
     return res;
 }
 
+template <typename T>
+DenseVector<T>& DenseVector<T>::add_scaled(const DenseVector<T>& b, T c) {
+    VRSGD_COUNT_OP(OP_AXPY, 3 * feature_num * sizeof(T));
+
+    assert(feature_num == b.feature_num);
+
+    for (int i = 0; i < feature_num; i++) {
+        vec[i] += c * b.vec[i];
+    }
+
+    return *this;
+}
+
+template <typename T>
+DenseVector<T>& DenseVector<T>::add_scaled(const SparseVector<T>& b, T c) {
+    VRSGD_COUNT_OP(OP_AXPY, b.get_nnz() * sizeof(FeaValPair<T>) + 2 * b.get_nnz() * sizeof(T));
+
+    assert(feature_num == b.get_feature_num());
+
+    for (const FeaValPair<T>& entry : b) {
+        vec[entry.fea] += c * entry.val;
+    }
+
+    return *this;
+}
+
+template <typename T>
+DenseVector<T>& DenseVector<T>::add_scaled_with_intcpt(const DenseVector<T>& b, T c) {
+    VRSGD_COUNT_OP(OP_INTCPT, 3 * feature_num * sizeof(T));
+
+    assert(feature_num == b.feature_num + 1);
+
+    for (int i = 0; i < feature_num - 1; i++) {
+        vec[i] += c * b.vec[i];
+    }
+    vec[feature_num - 1] += c;
+
+    return *this;
+}
+
+template <typename T>
+DenseVector<T>& DenseVector<T>::add_scaled_with_intcpt(const SparseVector<T>& b, T c) {
+    VRSGD_COUNT_OP(OP_INTCPT, b.get_nnz() * sizeof(FeaValPair<T>) + 2 * b.get_nnz() * sizeof(T));
+
+    assert(feature_num == b.get_feature_num() + 1);
+
+    for (const FeaValPair<T>& entry : b) {
+        vec[entry.fea] += c * entry.val;
+    }
+    vec[feature_num - 1] += c;
+
+    return *this;
+}
+
 template <typename T>
 T DenseVector<T>::dot_with_intcpt(const DenseVector<T>& b) const {
+    VRSGD_COUNT_OP(OP_INTCPT, 2 * feature_num * sizeof(T));
+
     assert(feature_num == b.feature_num + 1);
 
     T res = 0;
@@ -205,6 +299,8 @@ T DenseVector<T>::dot_with_intcpt(const DenseVector<T>& b) const {
 
 template <typename T>
 T DenseVector<T>::dot_with_intcpt(const SparseVector<T>& b) const {
+    VRSGD_COUNT_OP(OP_INTCPT, b.get_nnz() * sizeof(FeaValPair<T>) + b.get_nnz() * sizeof(T));
+
     assert(feature_num == b.get_feature_num() + 1);
 
     T res = 0;
@@ -219,6 +315,9 @@ T DenseVector<T>::dot_with_intcpt(const SparseVector<T>& b) const {
 
 template <typename T>
 SparseVector<T> SparseVector<T>::operator-() const {
+    VRSGD_COUNT_OP(OP_NEG, 2 * vec.size() * sizeof(FeaValPair<T>));
+    VRSGD_COUNT_TEMP(vec.size() * sizeof(FeaValPair<T>));
+
     SparseVector<T> res(*this);
 
     for (FeaValPair<T>& entry : res) {
@@ -230,6 +329,9 @@ SparseVector<T> SparseVector<T>::operator-() const {
 
 template <typename T>
 SparseVector<T> SparseVector<T>::operator*(T c) const {
+    VRSGD_COUNT_OP(OP_SCALE, 2 * vec.size() * sizeof(FeaValPair<T>));
+    VRSGD_COUNT_TEMP(vec.size() * sizeof(FeaValPair<T>));
+
     SparseVector<T> res(*this);
 
     for (FeaValPair<T>& entry : res) {
@@ -241,7 +343,11 @@ SparseVector<T> SparseVector<T>::operator*(T c) const {
 
 template <typename T>
 SparseVector<T> SparseVector<T>::scalar_multiple_with_intcpt(T c) const {
+    VRSGD_COUNT_OP(OP_INTCPT, 2 * vec.size() * sizeof(FeaValPair<T>));
+    VRSGD_COUNT_TEMP((vec.size() + 1) * sizeof(FeaValPair<T>));
+
     SparseVector<T> res(feature_num + 1);
+    res.vec.reserve(vec.size() + 1);
 
     for (const auto& entry : vec) {
         res.vec.emplace_back(entry.fea, c * entry.val);
@@ -253,6 +359,8 @@ SparseVector<T> SparseVector<T>::scalar_multiple_with_intcpt(T c) const {
 
 template <typename T>
 SparseVector<T>& SparseVector<T>::operator*=(T c) {
+    VRSGD_COUNT_OP(OP_SCALE, 2 * vec.size() * sizeof(FeaValPair<T>));
+
     for (FeaValPair<T>& entry : vec) {
         entry.val *= c;
     }
@@ -262,6 +370,9 @@ SparseVector<T>& SparseVector<T>::operator*=(T c) {
 
 template <typename T>
 SparseVector<T> SparseVector<T>::operator/(T c) const {
+    VRSGD_COUNT_OP(OP_SCALE, 2 * vec.size() * sizeof(FeaValPair<T>));
+    VRSGD_COUNT_TEMP(vec.size() * sizeof(FeaValPair<T>));
+
     SparseVector<T> res(*this);
 
     for (FeaValPair<T>& entry : res) {
@@ -273,6 +384,8 @@ SparseVector<T> SparseVector<T>::operator/(T c) const {
 
 template <typename T>
 SparseVector<T>& SparseVector<T>::operator/=(T c) {
+    VRSGD_COUNT_OP(OP_SCALE, 2 * vec.size() * sizeof(FeaValPair<T>));
+
     for (FeaValPair<T>& entry : vec) {
         entry.val /= c;
     }
@@ -282,6 +395,8 @@ SparseVector<T>& SparseVector<T>::operator/=(T c) {
 
 template <typename T>
 DenseVector<T> SparseVector<T>::operator+(const SparseVector<T>& b) const {
+    VRSGD_COUNT_OP(OP_ADD, vec.size() * sizeof(FeaValPair<T>) + b.get_nnz() * sizeof(FeaValPair<T>) + feature_num * sizeof(T));
+
     assert(feature_num == b.feature_num);
 
     DenseVector<T> res(*this);
@@ -295,6 +410,8 @@ DenseVector<T> SparseVector<T>::operator+(const SparseVector<T>& b) const {
 
 template <typename T>
 DenseVector<T> SparseVector<T>::operator-(const DenseVector<T>& b) const {
+    VRSGD_COUNT_OP(OP_ADD, vec.size() * sizeof(FeaValPair<T>) + feature_num * sizeof(T));
+
     assert(feature_num == b.get_feature_num());
 
     DenseVector<T> res(std::move(-b));
@@ -308,6 +425,8 @@ DenseVector<T> SparseVector<T>::operator-(const DenseVector<T>& b) const {
 
 template <typename T>
 DenseVector<T> SparseVector<T>::operator-(const SparseVector<T>& b) const {
+    VRSGD_COUNT_OP(OP_ADD, vec.size() * sizeof(FeaValPair<T>) + b.get_nnz() * sizeof(FeaValPair<T>) + feature_num * sizeof(T));
+
     assert(feature_num == b.feature_num);
 
     DenseVector<T> res(*this);
@@ -321,6 +440,8 @@ DenseVector<T> SparseVector<T>::operator-(const SparseVector<T>& b) const {
 
 template <typename T>
 T SparseVector<T>::dot_with_intcpt(const DenseVector<T>& b) const {
+    VRSGD_COUNT_OP(OP_INTCPT, vec.size() * sizeof(FeaValPair<T>) + vec.size() * sizeof(T));
+
     assert(feature_num == b.get_feature_num() + 1);
 
     T res = 0;
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "vector.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace VRSGD {
+
+/*
+ * Weights of num_output linear models over the same features, a
+ * feature_num x num_output matrix stored row-major: the num_output weights of
+ * a feature are contiguous, so a sparse row gathers each touched weight row
+ * once and the outputs are updated by short dense loops that vectorize.
+ *
+ * With intercept, the last row holds the intercepts and x has
+ * feature_num - 1 features, as with dot_with_intcpt.
+ */
+template <typename T>
+class WeightBlock {
+   public:
+    WeightBlock() = default;
+
+    WeightBlock(int feature_num, int num_output)
+        : feature_num(feature_num), num_output(num_output), vec((std::size_t)feature_num * num_output) {}
+
+    inline int get_feature_num() const { return feature_num; }
+
+    inline int get_num_output() const { return num_output; }
+
+    inline T* row(int fea) { return &vec[(std::size_t)fea * num_output]; }
+
+    inline const T* row(int fea) const { return &vec[(std::size_t)fea * num_output]; }
+
+    inline void set_zero() { std::fill(vec.begin(), vec.end(), 0); }
+
+    // out[k] = <w_k, x> for every output k
+    template <bool is_sparse>
+    void margins(const Vector<T, is_sparse>& x, bool intercept, T* out) const {
+        if (intercept) {
+            std::copy(row(feature_num - 1), row(feature_num - 1) + num_output, out);
+        } else {
+            std::fill(out, out + num_output, 0);
+        }
+        for (auto it = x.begin_feaval(); it != x.end_feaval(); ++it) {
+            const auto& entry = *it;
+            const T* w_row = row(entry.fea);
+            T val = entry.val;
+            for (int k = 0; k < num_output; k++) {
+                out[k] += val * w_row[k];
+            }
+        }
+    }
+
+    // w_k += c * coeff[k] * x for every output k
+    template <bool is_sparse>
+    void add_outer(const Vector<T, is_sparse>& x, bool intercept, const T* coeff, T c) {
+        if (intercept) {
+            T* w_row = row(feature_num - 1);
+            for (int k = 0; k < num_output; k++) {
+                w_row[k] += c * coeff[k];
+            }
+        }
+        for (auto it = x.begin_feaval(); it != x.end_feaval(); ++it) {
+            const auto& entry = *it;
+            T* w_row = row(entry.fea);
+            T val = c * entry.val;
+            for (int k = 0; k < num_output; k++) {
+                w_row[k] += val * coeff[k];
+            }
+        }
+    }
+
+    // this += c * b
+    void axpy(T c, const WeightBlock<T>& b) {
+        for (std::size_t i = 0; i < vec.size(); i++) {
+            vec[i] += c * b.vec[i];
+        }
+    }
+
+    WeightBlock<T>& operator*=(T c) {
+        for (auto& val : vec) {
+            val *= c;
+        }
+        return *this;
+    }
+
+    DenseVector<T> column(int k) const {
+        DenseVector<T> res(feature_num);
+        for (int i = 0; i < feature_num; i++) {
+            res[i] = vec[(std::size_t)i * num_output + k];
+        }
+        return res;
+    }
+
+    inline std::vector<T>& data() { return vec; }
+
+    inline const std::vector<T>& data() const { return vec; }
+
+   private:
+    int feature_num = 0;
+    int num_output = 0;
+    std::vector<T> vec;
+};
+
+}
@@ -2,29 +2,10 @@
 #include <lib/utils.hpp>
 #include <lib/prox.hpp>
 #include <algo/svrg.hpp>
+#include <problem/logistic_regression.hpp>
 
 #include <cmath>
 
-template<bool is_sparse>
-double logistic_regression_func(const VRSGD::DenseVector<double>& w, const VRSGD::Vector<double, is_sparse>& x) {
-    return 1./(1.+std::exp(-(w.dot_with_intcpt(x))));
-}
-
-template<bool is_sparse>
-double logistic_regression_cost_func(const VRSGD::DenseVector<double>& w, const std::vector<VRSGD::LabeledPoint<VRSGD::Vector<double, is_sparse>, double>>& data_points) {
-    double res = 0;
-    for (auto& data_point : data_points) {
-        double tmp = logistic_regression_func(w, data_point.x) - data_point.y;
-        res += tmp * tmp;
-    }
-    return res / data_points.size();
-}
-
-template<bool is_sparse>
-VRSGD::Vector<double, is_sparse> logistic_regression_grad(const VRSGD::DenseVector<double>& w, const VRSGD::LabeledPoint<VRSGD::Vector<double, is_sparse>, double>& data_point) {
-    return data_point.x.scalar_multiple_with_intcpt(logistic_regression_func(w, data_point.x) - data_point.y);
-}
-
 template<bool is_sparse>
 double calc_L(const std::vector<VRSGD::LabeledPoint<VRSGD::Vector<double, is_sparse>, double>>& data_points) {
     double max_L = std::sqrt(data_points[0].x.dot(data_points[0].x) + 1);
@@ -58,8 +39,10 @@ int main() {
 
     printf("L: %.15lf\n", calc_L(data_points));
 
+    VRSGD::LogisticRegression<is_sparse> logistic_regression(data_points, lambda);
+
     VRSGD::svrg_train<double, double, is_sparse>(
-            data_points,
+            logistic_regression,
             alpha,
             lambda,
             1,
@@ -67,9 +50,6 @@ int main() {
             2 * data_points.size(),
             feature_num + 1,
             0,
-            100,
-            logistic_regression_cost_func<is_sparse>,
-            logistic_regression_grad<is_sparse>,
-            VRSGD::prox_l1<double, false>);
+            100);
 }
 
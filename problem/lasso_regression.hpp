@@ -1,36 +1,40 @@
+#pragma once
+
 #include <lib/vector.hpp>
+#include <lib/data_view.hpp>
 #include <lib/prox.hpp>
 
+#include <cmath>
+
 namespace VRSGD {
 
 template <bool is_sparse>
 class LassoRegression {
  public:
-    LassoRegression(const std::vector<VRSGD::LabeledPoint<VRSGD::Vector<double, is_sparse>, double>>& data_points, double lambda)
+    LassoRegression(const DataView<VRSGD::LabeledPoint<VRSGD::Vector<double, is_sparse>, double>>& data_points, double lambda, bool intercept = false)
         : data_points(data_points),
-          lambda(lambda) {
+          lambda(lambda),
+          intercept(intercept) {
         data_num = data_points.size();
     }
 
     double cost_func(const VRSGD::DenseVector<double>& w) {
         double res = 0;
         for (auto& data_point : data_points) {
-            //double tmp = w.dot_with_intcpt(data_point.x) - data_point.y;
-            double tmp = w.dot(data_point.x) - data_point.y;
+            double tmp = margin(w, data_point.x) - data_point.y;
             res += tmp * tmp / (2 * data_points.size());
         }
 
-        res += lambda * w.norm();
+        res += lambda * reg_norm_l1(w);
 
         return res;
     }
 
-    VRSGD::Vector<double, is_sparse> grad_func(const VRSGD::DenseVector<double>& w) {
-        Vector<double, false> res;
+    VRSGD::DenseVector<double> grad_func(const VRSGD::DenseVector<double>& w) {
+        DenseVector<double> res(w.get_feature_num());
 
         for (const auto& data_point : data_points) {
-            //res += data_point.x.scalar_multiple_with_intcpt(w.dot_with_intcpt(data_point.x) - data_point.y);
-            res += data_point.x * (w.dot(data_point.x) - data_point.y) / data_num;
+            add_row_grad(res, data_point, w, 1. / data_num);
         }
 
         return res;
@@ -38,22 +42,83 @@ class LassoRegression {
 
     inline VRSGD::Vector<double, is_sparse> grad_func(const VRSGD::DenseVector<double>& w, int idx) {
         auto& data_point = data_points[idx];
-        //return data_point.x.scalar_multiple_with_intcpt(w.dot_with_intcpt(data_point.x) - data_point.y);
-        return data_point.x * (w.dot(data_point.x) - data_point.y);
+        return row_grad(data_point, w);
+    }
+
+    // Smooth part of the objective at row idx, grad_func(w, idx) is its gradient
+    inline double loss_func(const VRSGD::DenseVector<double>& w, int idx) {
+        double tmp = margin(w, data_points[idx].x) - data_points[idx].y;
+        return tmp * tmp / 2.;
     }
 
     inline DenseVector<double> prox_func(DenseVector<double> y, double alpha, double lambda) {
-        return prox_l1(y, alpha, lambda);
+        DenseVector<double> res = prox_l1(y, alpha, lambda);
+        if (intercept) {
+            res[y.get_feature_num() - 1] = y[y.get_feature_num() - 1];
+        }
+        return res;
+    }
+
+    // Lipschitz constant of grad_func(w, idx)
+    inline double smoothness(int idx) {
+        return data_points[idx].x.norm_sqr() + (intercept ? 1. : 0.);
     }
 
     int size() {
         return data_num;
     }
 
+    inline const DataView<LabeledPoint<VRSGD::Vector<double, is_sparse>, double>>& get_data_points() const {
+        return data_points;
+    }
+
+    inline double get_lambda() const {
+        return lambda;
+    }
+
+    inline bool has_intercept() const {
+        return intercept;
+    }
+
  protected:
-    const std::vector<LabeledPoint<VRSGD::Vector<double, is_sparse>, double>>& data_points;
+    // With intercept, w has feature_num + 1 entries and the last one is the
+    // unregularized intercept, see dot_with_intcpt
+    inline double margin(const VRSGD::DenseVector<double>& w, const VRSGD::Vector<double, is_sparse>& x) const {
+        return intercept ? w.dot_with_intcpt(x) : w.dot(x);
+    }
+
+    // res += c * the gradient of the squared loss of the row, in place
+    // without a temporary
+    inline void add_row_grad(VRSGD::DenseVector<double>& res, const LabeledPoint<VRSGD::Vector<double, is_sparse>, double>& data_point,
+                             const VRSGD::DenseVector<double>& w, double c) const {
+        double residual = margin(w, data_point.x) - data_point.y;
+        if (intercept) {
+            res.add_scaled_with_intcpt(data_point.x, c * residual);
+        } else {
+            res.add_scaled(data_point.x, c * residual);
+        }
+    }
+
+    inline VRSGD::Vector<double, is_sparse> row_grad(const LabeledPoint<VRSGD::Vector<double, is_sparse>, double>& data_point,
+                                                   const VRSGD::DenseVector<double>& w) const {
+        double residual = margin(w, data_point.x) - data_point.y;
+        return intercept ? scaled_with_intcpt(data_point.x, residual) : data_point.x * residual;
+    }
+
+    // Sum of |w_j| without the intercept
+    inline double reg_norm_l1(const VRSGD::DenseVector<double>& w) const {
+        int reg_num = intercept ? w.get_feature_num() - 1 : w.get_feature_num();
+        double res = 0;
+        for (int j = 0; j < reg_num; j++) {
+            res += std::abs(w[j]);
+        }
+        return res;
+    }
+
+    DataView<LabeledPoint<VRSGD::Vector<double, is_sparse>, double>> data_points;
     int data_num;
     double lambda;
+    bool intercept;
 };
 
 }
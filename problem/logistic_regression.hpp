@@ -0,0 +1,82 @@
+#pragma once
+
+#include <lib/vector.hpp>
+#include <lib/data_view.hpp>
+#include <lib/prox.hpp>
+
+#include <cmath>
+
+namespace VRSGD {
+
+// L1-regularized logistic regression with labels in {0, 1}. The intercept is
+// stored as the last entry of w, so w has feature_num + 1 entries; it is not
+// regularized.
+template <bool is_sparse>
+class LogisticRegression {
+ public:
+    LogisticRegression(const DataView<VRSGD::LabeledPoint<VRSGD::Vector<double, is_sparse>, double>>& data_points, double lambda)
+        : data_points(data_points),
+          lambda(lambda) {
+        data_num = data_points.size();
+    }
+
+    inline double predict(const VRSGD::DenseVector<double>& w, const VRSGD::Vector<double, is_sparse>& x) {
+        return 1. / (1. + std::exp(-w.dot_with_intcpt(x)));
+    }
+
+    double cost_func(const VRSGD::DenseVector<double>& w) {
+        double res = 0;
+        for (int i = 0; i < data_num; i++) {
+            res += loss_func(w, i) / data_num;
+        }
+
+        for (int i = 0; i < w.get_feature_num() - 1; i++) {
+            res += lambda * std::abs(w[i]);
+        }
+
+        return res;
+    }
+
+    inline VRSGD::Vector<double, is_sparse> grad_func(const VRSGD::DenseVector<double>& w, int idx) {
+        auto& data_point = data_points[idx];
+        return scaled_with_intcpt(data_point.x, predict(w, data_point.x) - data_point.y);
+    }
+
+    // Smooth part of the objective at row idx, grad_func(w, idx) is its gradient
+    inline double loss_func(const VRSGD::DenseVector<double>& w, int idx) {
+        // log(1 + exp(-z)) for y = 1 and log(1 + exp(z)) for y = 0, computed without overflow
+        double z = w.dot_with_intcpt(data_points[idx].x);
+        double margin = data_points[idx].y > 0 ? z : -z;
+        return margin > 0 ? std::log1p(std::exp(-margin)) : -margin + std::log1p(std::exp(margin));
+    }
+
+    inline DenseVector<double> prox_func(const DenseVector<double>& y, double alpha, double lambda) {
+        DenseVector<double> res = prox_l1(y, alpha, lambda);
+        res[y.get_feature_num() - 1] = y[y.get_feature_num() - 1];
+        return res;
+    }
+
+    // Lipschitz constant of grad_func(w, idx)
+    inline double smoothness(int idx) {
+        return (data_points[idx].x.norm_sqr() + 1.) / 4.;
+    }
+
+    int size() {
+        return data_num;
+    }
+
+    inline const DataView<LabeledPoint<VRSGD::Vector<double, is_sparse>, double>>& get_data_points() const {
+        return data_points;
+    }
+
+    inline bool has_intercept() const {
+        return true;
+    }
+
+ protected:
+    DataView<LabeledPoint<VRSGD::Vector<double, is_sparse>, double>> data_points;
+    int data_num;
+    double lambda;
+};
+
+}
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <lib/vector.hpp>
+#include <lib/prox.hpp>
+#include <lib/weight_block.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <vector>
+
+namespace VRSGD {
+
+/*
+ * num_output linear models over the same rows, trained together by
+ * multi_saga_train. labels[i * num_output + k] is the label of row i for
+ * output k. The gradient of output k at row i is x_i * res[k], with res from
+ * residual_func, so a row costs one pass over its features for all outputs.
+ *
+ * @param loss_opt
+ * 0: squared loss, L2 regularization (as RidgeRegressionProx)
+ * 1: squared loss, L1 regularization
+ * 2: logistic loss with labels in {0, 1}, L1 regularization and an intercept
+ *    in the last weight row (as LogisticRegression)
+ *
+ * @param intercept
+ * loss_opt 0 and 1: fit an unregularized intercept in the last weight row too
+ */
+template <bool is_sparse>
+class MultiOutputProblem {
+ public:
+    MultiOutputProblem(const std::vector<VRSGD::LabeledPoint<VRSGD::Vector<double, is_sparse>, double>>& data_points,
+                       const std::vector<double>& labels, int num_output, int loss_opt, double lambda,
+                       bool intercept = false)
+        : data_points(data_points),
+          labels(labels),
+          num_output(num_output),
+          loss_opt(loss_opt),
+          lambda(lambda),
+          intercept(intercept || loss_opt == 2),
+          margin(num_output) {
+        data_num = data_points.size();
+    }
+
+    // Objective averaged over the outputs
+    double cost_func(const WeightBlock<double>& w) {
+        double res = 0;
+        for (int i = 0; i < data_num; i++) {
+            w.margins(data_points[i].x, has_intercept(), margin.data());
+            const double* y = &labels[(std::size_t)i * num_output];
+            for (int k = 0; k < num_output; k++) {
+                if (loss_opt == 2) {
+                    double z = y[k] > 0 ? margin[k] : -margin[k];
+                    res += z > 0 ? std::log1p(std::exp(-z)) : -z + std::log1p(std::exp(z));
+                } else {
+                    res += (margin[k] - y[k]) * (margin[k] - y[k]) / 2.;
+                }
+            }
+        }
+        res /= data_num;
+
+        int reg_rows = has_intercept() ? w.get_feature_num() - 1 : w.get_feature_num();
+        for (int j = 0; j < reg_rows; j++) {
+            for (int k = 0; k < num_output; k++) {
+                double val = w.row(j)[k];
+                res += loss_opt == 0 ? lambda / 2. * val * val : lambda * std::abs(val);
+            }
+        }
+
+        return res / num_output;
+    }
+
+    // res[k] = derivative of the loss of output k at row idx w.r.t. its margin
+    inline void residual_func(const WeightBlock<double>& w, int idx, double* res) {
+        w.margins(data_points[idx].x, has_intercept(), res);
+        const double* y = &labels[(std::size_t)idx * num_output];
+        for (int k = 0; k < num_output; k++) {
+            res[k] = loss_opt == 2 ? 1. / (1. + std::exp(-res[k])) - y[k] : res[k] - y[k];
+        }
+    }
+
+    // In place, the intercept row is not regularized
+    void prox_func(WeightBlock<double>& w, double alpha, double lambda) {
+        int reg_rows = has_intercept() ? w.get_feature_num() - 1 : w.get_feature_num();
+        for (int j = 0; j < reg_rows; j++) {
+            double* w_row = w.row(j);
+            for (int k = 0; k < num_output; k++) {
+                w_row[k] = loss_opt == 0 ? w_row[k] / (1 + alpha * lambda) : prox_l1(w_row[k], alpha * lambda);
+            }
+        }
+    }
+
+    // Lipschitz constant of the gradient of every output at row idx
+    inline double smoothness(int idx) {
+        double norm_sqr = data_points[idx].x.norm_sqr() + (intercept ? 1. : 0.);
+        return loss_opt == 2 ? norm_sqr / 4. : norm_sqr;
+    }
+
+    inline bool has_intercept() const {
+        return intercept;
+    }
+
+    inline int get_num_output() const {
+        return num_output;
+    }
+
+    inline const Vector<double, is_sparse>& get_x(int idx) const {
+        return data_points[idx].x;
+    }
+
+    int size() {
+        return data_num;
+    }
+
+ protected:
+    const std::vector<LabeledPoint<VRSGD::Vector<double, is_sparse>, double>>& data_points;
+    const std::vector<double>& labels;
+    int data_num;
+    int num_output;
+    int loss_opt;
+    double lambda;
+    bool intercept;
+    std::vector<double> margin;
+};
+
+/*
+ * One-vs-rest labels: output k is positive (1) for the rows whose y equals
+ * classes[k] and negative otherwise. classes receives the distinct y in
+ * increasing order.
+ */
+template <bool is_sparse>
+void one_vs_rest_labels(const std::vector<LabeledPoint<Vector<double, is_sparse>, double>>& data_points,
+                        double negative, std::vector<double>& classes, std::vector<double>& labels) {
+    classes.clear();
+    for (const auto& data_point : data_points) {
+        classes.push_back(data_point.y);
+    }
+    std::sort(classes.begin(), classes.end());
+    classes.erase(std::unique(classes.begin(), classes.end()), classes.end());
+
+    std::map<double, int> class_idx;
+    for (std::size_t k = 0; k < classes.size(); k++) {
+        class_idx[classes[k]] = k;
+    }
+
+    int num_output = classes.size();
+    labels.assign(data_points.size() * num_output, negative);
+    for (std::size_t i = 0; i < data_points.size(); i++) {
+        labels[i * num_output + class_idx[data_points[i].y]] = 1;
+    }
+}
+
+}
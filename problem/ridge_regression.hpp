@@ -1,4 +1,7 @@
+#pragma once
+
 #include <lib/vector.hpp>
+#include <lib/data_view.hpp>
 #include <lib/prox.hpp>
 
 namespace VRSGD {
@@ -6,84 +9,144 @@ namespace VRSGD {
 template <bool is_sparse>
 class RidgeRegression {
  public:
-    RidgeRegression(const std::vector<VRSGD::LabeledPoint<VRSGD::Vector<double, is_sparse>, double>>& data_points, double lambda)
+    RidgeRegression(const DataView<VRSGD::LabeledPoint<VRSGD::Vector<double, is_sparse>, double>>& data_points, double lambda, bool intercept = false)
         : data_points(data_points),
-          lambda(lambda) {
+          lambda(lambda),
+          intercept(intercept) {
         data_num = data_points.size();
     }
 
     double cost_func(const VRSGD::DenseVector<double>& w) {
         double res = 0;
         for (auto& data_point : data_points) {
-            //double tmp = w.dot_with_intcpt(data_point.x) - data_point.y;
-            double tmp = w.dot(data_point.x) - data_point.y;
+            double tmp = margin(w, data_point.x) - data_point.y;
             res += tmp * tmp / (2 * data_points.size());
         }
 
-        res += lambda / 2. * w.norm_sqr();
+        res += lambda / 2. * reg_norm_sqr(w);
 
         return res;
     }
 
     VRSGD::DenseVector<double> grad_func(const VRSGD::DenseVector<double>& w) {
-        Vector<double, false> res;
+        DenseVector<double> res(w.get_feature_num());
 
         for (const auto& data_point : data_points) {
-            //res += data_point.x.scalar_multiple_with_intcpt(w.dot_with_intcpt(data_point.x) - data_point.y);
-            res += data_point.x * (w.dot(data_point.x) - data_point.y) / data_num;
+            add_row_grad(res, data_point, w, 1. / data_num);
         }
 
-        return res + lambda * w;
+        res += lambda * w;
+        if (intercept) {
+            res[w.get_feature_num() - 1] -= lambda * w[w.get_feature_num() - 1];
+        }
+        return res;
     }
 
+    // Written into one buffer of w's size, the intercept entry is not regularized
     inline VRSGD::DenseVector<double> grad_func(const VRSGD::DenseVector<double>& w, int idx) {
         auto& data_point = data_points[idx];
-        //return data_point.x.scalar_multiple_with_intcpt(w.dot_with_intcpt(data_point.x) - data_point.y);
-        return data_point.x * (w.dot(data_point.x) - data_point.y) + lambda * w;
+        double residual = margin(w, data_point.x) - data_point.y;
+        DenseVector<double> res = w * lambda;
+        if (intercept) {
+            res[w.get_feature_num() - 1] = 0;
+            res.add_scaled_with_intcpt(data_point.x, residual);
+        } else {
+            res.add_scaled(data_point.x, residual);
+        }
+        return res;
+    }
+
+    // Smooth part of the objective at row idx, grad_func(w, idx) is its gradient
+    inline double loss_func(const VRSGD::DenseVector<double>& w, int idx) {
+        double tmp = margin(w, data_points[idx].x) - data_points[idx].y;
+        return tmp * tmp / 2. + lambda / 2. * reg_norm_sqr(w);
     }
 
     DenseVector<double> prox_func(DenseVector<double> y, double, double) {
         return y;
     }
 
+    // Lipschitz constant of grad_func(w, idx)
+    inline double smoothness(int idx) {
+        return data_points[idx].x.norm_sqr() + (intercept ? 1. : 0.) + lambda;
+    }
+
     int size() {
         return data_num;
     }
 
+    inline const DataView<LabeledPoint<VRSGD::Vector<double, is_sparse>, double>>& get_data_points() const {
+        return data_points;
+    }
+
+    inline double get_lambda() const {
+        return lambda;
+    }
+
+    inline bool has_intercept() const {
+        return intercept;
+    }
+
  protected:
-    const std::vector<LabeledPoint<VRSGD::Vector<double, is_sparse>, double>>& data_points;
+    // With intercept, w has feature_num + 1 entries and the last one is the
+    // unregularized intercept, see dot_with_intcpt
+    inline double margin(const VRSGD::DenseVector<double>& w, const VRSGD::Vector<double, is_sparse>& x) const {
+        return intercept ? w.dot_with_intcpt(x) : w.dot(x);
+    }
+
+    // res += c * the gradient of the squared loss of the row, in place
+    // without a temporary
+    inline void add_row_grad(VRSGD::DenseVector<double>& res, const LabeledPoint<VRSGD::Vector<double, is_sparse>, double>& data_point,
+                             const VRSGD::DenseVector<double>& w, double c) const {
+        double residual = margin(w, data_point.x) - data_point.y;
+        if (intercept) {
+            res.add_scaled_with_intcpt(data_point.x, c * residual);
+        } else {
+            res.add_scaled(data_point.x, c * residual);
+        }
+    }
+
+    inline double reg_norm_sqr(const VRSGD::DenseVector<double>& w) const {
+        double res = w.norm_sqr();
+        if (intercept) {
+            res -= w[w.get_feature_num() - 1] * w[w.get_feature_num() - 1];
+        }
+        return res;
+    }
+
+    DataView<LabeledPoint<VRSGD::Vector<double, is_sparse>, double>> data_points;
     int data_num;
     double lambda;
+    bool intercept;
 };
 
 template <bool is_sparse>
 class RidgeRegressionProx {
  public:
-    RidgeRegressionProx(const std::vector<VRSGD::LabeledPoint<VRSGD::Vector<double, is_sparse>, double>>& data_points, double lambda)
+    RidgeRegressionProx(const DataView<VRSGD::LabeledPoint<VRSGD::Vector<double, is_sparse>, double>>& data_points, double lambda, bool intercept = false)
         : data_points(data_points),
-          lambda(lambda) {
+          lambda(lambda),
+          intercept(intercept) {
         data_num = data_points.size();
     }
 
     double cost_func(const VRSGD::DenseVector<double>& w) {
         double res = 0;
         for (auto& data_point : data_points) {
-            //double tmp = w.dot_with_intcpt(data_point.x) - data_point.y;
-            double tmp = w.dot(data_point.x) - data_point.y;
+            double tmp = margin(w, data_point.x) - data_point.y;
             res += tmp * tmp / (2 * data_points.size());
         }
 
-        res += lambda / 2. * w.norm_sqr();
+        res += lambda / 2. * reg_norm_sqr(w);
 
         return res;
     }
 
     VRSGD::DenseVector<double> grad_func(const VRSGD::DenseVector<double>& w) {
-        Vector<double, false> res;
+        DenseVector<double> res(w.get_feature_num());
 
         for (const auto& data_point : data_points) {
-            //res += data_point.x.scalar_multiple_with_intcpt(w.dot_with_intcpt(data_point.x) - data_point.y);
-            res += data_point.x * (w.dot(data_point.x) - data_point.y) / data_num;
+            add_row_grad(res, data_point, w, 1. / data_num);
         }
 
         return res;
@@ -91,22 +154,81 @@ class RidgeRegressionProx {
 
     inline VRSGD::DenseVector<double> grad_func(const VRSGD::DenseVector<double>& w, int idx) {
         auto& data_point = data_points[idx];
-        //return data_point.x.scalar_multiple_with_intcpt(w.dot_with_intcpt(data_point.x) - data_point.y);
-        return data_point.x * (w.dot(data_point.x) - data_point.y);
+        return row_grad(data_point, w);
+    }
+
+    // Smooth part of the objective at row idx, grad_func(w, idx) is its gradient
+    inline double loss_func(const VRSGD::DenseVector<double>& w, int idx) {
+        double tmp = margin(w, data_points[idx].x) - data_points[idx].y;
+        return tmp * tmp / 2.;
     }
 
     inline DenseVector<double> prox_func(const DenseVector<double>& y, double alpha, double lambda) {
-        return prox_l2(y, alpha, lambda);
+        DenseVector<double> res = prox_l2(y, alpha, lambda);
+        if (intercept) {
+            res[y.get_feature_num() - 1] = y[y.get_feature_num() - 1];
+        }
+        return res;
+    }
+
+    // Lipschitz constant of grad_func(w, idx)
+    inline double smoothness(int idx) {
+        return data_points[idx].x.norm_sqr() + (intercept ? 1. : 0.);
     }
 
     int size() {
         return data_num;
     }
 
+    inline const DataView<LabeledPoint<VRSGD::Vector<double, is_sparse>, double>>& get_data_points() const {
+        return data_points;
+    }
+
+    inline double get_lambda() const {
+        return lambda;
+    }
+
+    inline bool has_intercept() const {
+        return intercept;
+    }
+
  private:
-    const std::vector<LabeledPoint<VRSGD::Vector<double, is_sparse>, double>>& data_points;
+    // With intercept, w has feature_num + 1 entries and the last one is the
+    // unregularized intercept, see dot_with_intcpt
+    inline double margin(const VRSGD::DenseVector<double>& w, const VRSGD::Vector<double, is_sparse>& x) const {
+        return intercept ? w.dot_with_intcpt(x) : w.dot(x);
+    }
+
+    // res += c * the gradient of the squared loss of the row, in place
+    // without a temporary
+    inline void add_row_grad(VRSGD::DenseVector<double>& res, const LabeledPoint<VRSGD::Vector<double, is_sparse>, double>& data_point,
+                             const VRSGD::DenseVector<double>& w, double c) const {
+        double residual = margin(w, data_point.x) - data_point.y;
+        if (intercept) {
+            res.add_scaled_with_intcpt(data_point.x, c * residual);
+        } else {
+            res.add_scaled(data_point.x, c * residual);
+        }
+    }
+
+    inline VRSGD::Vector<double, is_sparse> row_grad(const LabeledPoint<VRSGD::Vector<double, is_sparse>, double>& data_point,
+                                                   const VRSGD::DenseVector<double>& w) const {
+        double residual = margin(w, data_point.x) - data_point.y;
+        return intercept ? scaled_with_intcpt(data_point.x, residual) : data_point.x * residual;
+    }
+
+    inline double reg_norm_sqr(const VRSGD::DenseVector<double>& w) const {
+        double res = w.norm_sqr();
+        if (intercept) {
+            res -= w[w.get_feature_num() - 1] * w[w.get_feature_num() - 1];
+        }
+        return res;
+    }
+
+    DataView<LabeledPoint<VRSGD::Vector<double, is_sparse>, double>> data_points;
     int data_num;
     double lambda;
+    bool intercept;
 };
 
 }
@@ -0,0 +1,154 @@
+// Batch scoring of a model written by train:
+//
+//   ./score --model covtype.model --data ./datasets/covtype.binary --threads 8 --output scores.txt
+//
+// The data is streamed in batches of batch_rows rows, each batch is parsed
+// and scored on all threads, so the file does not have to fit into memory.
+// RMSE, accuracy and AUC over all rows are printed at the end.
+//
+// The preprocessing and the feature hashing (train --hash_bits) stored in the
+// model by train are replayed on every batch; --normalize and --label_threshold
+// are for models written without preprocessing.
+
+#include <lib/vector.hpp>
+#include <lib/utils.hpp>
+#include <lib/model.hpp>
+#include <lib/scoring.hpp>
+#include <lib/preprocess.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+typedef VRSGD::LabeledPoint<VRSGD::Vector<double, true>, double> LabeledPoint_;
+
+int main(int argc, char** argv) {
+    std::map<std::string, std::string> args = {
+        {"model", ""},
+        {"data", ""},
+        {"format", "libsvm"},       // libsvm or binary
+        {"threads", "1"},
+        {"batch_rows", "1048576"},
+        {"output", ""},             // one prediction per line
+        {"normalize", "0"},         // scale every row to unit L2 norm
+        {"label_threshold", ""},    // map y < threshold to -1 (0 for logistic) and the rest to 1
+    };
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string key = std::string(argv[i]).substr(2);
+        if (args.count(key) == 0) {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 1;
+        }
+        args[key] = argv[i + 1];
+    }
+    if (args["model"] == "" || args["data"] == "") {
+        fprintf(stderr, "usage: %s --model <file> --data <file> [--<key> <value> ...]\n", argv[0]);
+        return 1;
+    }
+
+    VRSGD::Model model;
+    if (!VRSGD::load_model(model, args["model"])) {
+        fprintf(stderr, "cannot read model %s\n", args["model"].c_str());
+        return 1;
+    }
+    VRSGD::Scorer scorer(model);
+
+    VRSGD::Preprocess preprocess;
+    if (!preprocess.load(model)) {
+        fprintf(stderr, "bad preprocessing in model %s\n", args["model"].c_str());
+        return 1;
+    }
+    if (std::stoi(args["normalize"])) {
+        preprocess.normalize = true;
+    }
+    if (args["label_threshold"] != "") {
+        preprocess.map_label = true;
+        preprocess.label_threshold = std::stod(args["label_threshold"]);
+        preprocess.negative = model.problem == "logistic" ? 0 : -1;
+    }
+
+    VRSGD::FeatureHasher hasher;
+    if (!hasher.load(model)) {
+        fprintf(stderr, "bad hashing in model %s\n", args["model"].c_str());
+        return 1;
+    }
+
+    int num_threads = std::stoi(args["threads"]);
+    int batch_rows = std::stoi(args["batch_rows"]);
+    if (num_threads < 1 || batch_rows < 1) {
+        fprintf(stderr, "threads and batch_rows must be > 0\n");
+        return 1;
+    }
+
+    bool binary = args["format"] == "binary";
+    std::ifstream fs;
+    std::unique_ptr<VRSGD::BinaryReader> reader;
+    if (binary) {
+        reader.reset(new VRSGD::BinaryReader(args["data"]));
+        if (reader->get_feature_num() != model.feature_num) {
+            fprintf(stderr, "%s is not in the binary format or has a different feature_num\n", args["data"].c_str());
+            return 1;
+        }
+    } else {
+        fs.open(args["data"]);
+        if (!fs) {
+            fprintf(stderr, "cannot read %s\n", args["data"].c_str());
+            return 1;
+        }
+    }
+
+    FILE* out = nullptr;
+    if (args["output"] != "" && !(out = fopen(args["output"].c_str(), "w"))) {
+        fprintf(stderr, "cannot write %s\n", args["output"].c_str());
+        return 1;
+    }
+
+    std::vector<LabeledPoint_> data_points;
+    std::vector<double> scores;
+    std::vector<VRSGD::Metrics> metrics(num_threads);
+    double score_time = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    while (true) {
+        data_points.clear();
+        int num = binary ? reader->next_batch(data_points, batch_rows)
+                         : VRSGD::read_libsvm_batch(fs, data_points, model.feature_num, batch_rows, num_threads,
+                                                    hasher.enabled() ? &hasher : nullptr);
+        if (num < 0) {
+            fprintf(stderr, "%s is corrupt\n", args["data"].c_str());
+            return 1;
+        }
+        if (num == 0) {
+            break;
+        }
+
+        auto score_start = std::chrono::steady_clock::now();
+        preprocess.apply(data_points, num_threads);
+        VRSGD::score_batch(scorer, data_points, scores, metrics, num_threads);
+        score_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - score_start).count();
+
+        if (out) {
+            for (double score : scores) {
+                fprintf(out, "%.10g\n", score);
+            }
+        }
+    }
+    if (out) {
+        fclose(out);
+    }
+
+    for (int t = 1; t < num_threads; t++) {
+        metrics[0].merge(metrics[t]);
+    }
+    double total_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("rows: %lld\n", metrics[0].size());
+    printf("rmse: %.10f\n", metrics[0].rmse());
+    printf("accuracy: %.10f\n", metrics[0].accuracy());
+    printf("auc: %.10f\n", metrics[0].auc());
+    printf("rows_per_sec: %.1f (scoring only: %.1f)\n", metrics[0].size() / total_time, metrics[0].size() / score_time);
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+// Minimal assertions for the test executables: a failed check prints its
+// location and the test goes on, main() returns test_result() so ctest sees
+// any failure.
+
+#include <cmath>
+#include <cstdio>
+
+namespace VRSGD {
+
+inline int& test_failures() {
+    static int failures = 0;
+    return failures;
+}
+
+inline bool check(bool ok, const char* expr, const char* file, int line) {
+    if (!ok) {
+        fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expr);
+        test_failures()++;
+    }
+    return ok;
+}
+
+inline bool check_near(double a, double b, double tol, const char* expr, const char* file, int line) {
+    bool ok = std::abs(a - b) <= tol;
+    if (!ok) {
+        fprintf(stderr, "%s:%d: check failed: %s, %.17g vs %.17g\n", file, line, expr, a, b);
+        test_failures()++;
+    }
+    return ok;
+}
+
+inline int test_result() {
+    if (test_failures() > 0) {
+        fprintf(stderr, "%d checks failed\n", test_failures());
+        return 1;
+    }
+    return 0;
+}
+
+}
+
+#define VRSGD_CHECK(expr) VRSGD::check((expr), #expr, __FILE__, __LINE__)
+
+#define VRSGD_CHECK_NEAR(a, b, tol) VRSGD::check_near((a), (b), (tol), #a " ~ " #b, __FILE__, __LINE__)
@@ -0,0 +1,230 @@
+// Round trips of the files written by train: the model of lib/model.hpp, the
+// SAGA state of algo/saga.hpp and the binary data of lib/utils.hpp, and
+// rejection of damaged ones.
+
+#include <lib/vector.hpp>
+#include <lib/utils.hpp>
+#include <lib/model.hpp>
+#include <lib/sampler.hpp>
+#include <lib/synthetic.hpp>
+#include <algo/saga.hpp>
+#include <problem/lasso_regression.hpp>
+
+#include "check.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+typedef VRSGD::LabeledPoint<VRSGD::Vector<double, true>, double> LabeledPoint_;
+
+std::string read_file(const std::string& filename) {
+    std::ifstream fs(filename, std::ifstream::binary);
+    std::stringstream ss;
+    ss << fs.rdbuf();
+    return ss.str();
+}
+
+void write_file(const std::string& filename, const std::string& content) {
+    std::ofstream fs(filename, std::ofstream::binary);
+    fs << content;
+}
+
+void test_model() {
+    const std::string filename = "io_test.model";
+
+    VRSGD::Model model;
+    model.problem = "lasso";
+    model.feature_num = 3;
+    model.w = VRSGD::DenseVector<double>(4);
+    model.w[0] = 1. / 3.;
+    model.w[1] = -1e-300;
+    model.w[2] = 1e300;
+    model.w[3] = -0.1;
+    model.meta["standardize"] = "0.5 2 1";
+    model.meta["label_threshold"] = "3";
+    VRSGD_CHECK(VRSGD::save_model(model, filename));
+
+    VRSGD::Model loaded;
+    VRSGD_CHECK(VRSGD::load_model(loaded, filename));
+    VRSGD_CHECK(loaded.problem == model.problem);
+    VRSGD_CHECK(loaded.feature_num == model.feature_num);
+    VRSGD_CHECK(loaded.has_intercept());
+    VRSGD_CHECK(loaded.meta == model.meta);
+    if (VRSGD_CHECK(loaded.w.get_feature_num() == model.w.get_feature_num())) {
+        for (int i = 0; i < model.w.get_feature_num(); i++) {
+            VRSGD_CHECK(loaded.w[i] == model.w[i]);
+        }
+    }
+
+    // A w missing its last entry and a wrong header are rejected
+    std::string content = read_file(filename);
+    write_file(filename, content.substr(0, content.rfind('\n', content.size() - 2) + 1));
+    VRSGD_CHECK(!VRSGD::load_model(loaded, filename));
+    write_file(filename, "vrsgd_model 2\n" + content.substr(content.find('\n') + 1));
+    VRSGD_CHECK(!VRSGD::load_model(loaded, filename));
+    VRSGD_CHECK(!VRSGD::load_model(loaded, "io_test.missing"));
+
+    std::remove(filename.c_str());
+}
+
+template <typename VectorT>
+std::vector<double> to_dense(const VectorT& x, int feature_num) {
+    std::vector<double> res(feature_num);
+    for (auto it = x.begin_feaval(); it != x.end_feaval(); ++it) {
+        res[(*it).fea] = (*it).val;
+    }
+    return res;
+}
+
+template <typename StateT>
+bool same_state(const StateT& a, const StateT& b) {
+    if (a.w.get_feature_num() != b.w.get_feature_num() || a.table.size() != b.table.size()) {
+        return false;
+    }
+    int feature_num = a.w.get_feature_num();
+    for (int j = 0; j < feature_num; j++) {
+        if (a.w[j] != b.w[j] || a.table_avg[j] != b.table_avg[j]) {
+            return false;
+        }
+    }
+    for (std::size_t i = 0; i < a.table.size(); i++) {
+        if (to_dense(a.table[i], feature_num) != to_dense(b.table[i], feature_num)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void test_saga_state() {
+    const std::string filename = "io_test.saga_state";
+    const int data_num = 100;
+    const int feature_num = 10;
+    const double lambda = 1e-3;
+
+    std::vector<LabeledPoint_> data_points;
+    VRSGD::make_synthetic(data_points, data_num, feature_num, 0.3, 0.1, 0, 1);
+    VRSGD::LassoRegression<true> problem(data_points, lambda);
+    auto quiet = [](int, double) { return true; };
+
+    // An empty state trains like saga_train
+    VRSGD::SagaStateOf<double, decltype(problem)> state;
+    VRSGD::saga_train_incremental<double, double, true>(problem, 0.3, lambda, 1, 3 * data_num, feature_num, data_num,
+                                                        state, VRSGD::Sampler<>(0, 1), quiet);
+    auto w = VRSGD::saga_train<double, double, true>(problem, 0.3, lambda, 1, 3 * data_num, feature_num, data_num,
+                                                     VRSGD::Sampler<>(0, 1), quiet);
+    for (int j = 0; j < feature_num; j++) {
+        VRSGD_CHECK(state.w[j] == w[j]);
+    }
+    VRSGD_CHECK((int)state.table.size() == data_num);
+
+    VRSGD_CHECK(VRSGD::save_saga_state(state, filename));
+    decltype(state) loaded;
+    VRSGD_CHECK(VRSGD::load_saga_state(loaded, filename));
+    VRSGD_CHECK(same_state(state, loaded));
+
+    // Damaged files are rejected and leave the state unchanged
+    const std::string content = read_file(filename);
+    std::size_t first_row = 8 + 4 + 8 + 2 * feature_num * sizeof(double);
+    int32_t nnz;
+    memcpy(&nnz, content.data() + first_row, sizeof(nnz));
+    VRSGD_CHECK(nnz > 0);
+
+    std::vector<std::string> damaged;
+    damaged.push_back("VRSGDSAX" + content.substr(8));
+    damaged.push_back(content.substr(0, content.size() - 4));
+    std::string bad = content;
+    int32_t val = -1;
+    memcpy(&bad[first_row], &val, sizeof(val));
+    damaged.push_back(bad);
+    bad = content;
+    val = feature_num + 1;
+    memcpy(&bad[first_row], &val, sizeof(val));
+    damaged.push_back(bad);
+    bad = content;
+    val = feature_num;
+    memcpy(&bad[first_row + 4], &val, sizeof(val));
+    damaged.push_back(bad);
+    bad = content;
+    val = -1;
+    memcpy(&bad[first_row + 4], &val, sizeof(val));
+    damaged.push_back(bad);
+
+    for (const auto& file : damaged) {
+        write_file(filename, file);
+        VRSGD_CHECK(!VRSGD::load_saga_state(loaded, filename));
+        VRSGD_CHECK(same_state(state, loaded));
+    }
+    VRSGD_CHECK(!VRSGD::load_saga_state(loaded, "io_test.missing"));
+
+    std::remove(filename.c_str());
+}
+
+template <bool is_sparse>
+void test_binary() {
+    typedef VRSGD::LabeledPoint<VRSGD::Vector<double, is_sparse>, double> Point;
+    const std::string filename = "io_test.bin";
+    const int feature_num = 10;
+
+    std::vector<Point> data_points;
+    VRSGD::make_synthetic(data_points, 20, feature_num, 0.3, 0.1, 0, 1);
+    VRSGD::write_binary(data_points, filename);
+
+    std::vector<Point> loaded;
+    VRSGD_CHECK(VRSGD::read_binary(loaded, filename) == feature_num);
+    if (VRSGD_CHECK(loaded.size() == data_points.size())) {
+        for (std::size_t i = 0; i < data_points.size(); i++) {
+            VRSGD_CHECK(loaded[i].y == data_points[i].y);
+            VRSGD_CHECK(to_dense(loaded[i].x, feature_num) == to_dense(data_points[i].x, feature_num));
+        }
+    }
+
+    // Damaged files are rejected and leave data_points unchanged
+    const std::string content = read_file(filename);
+    std::size_t first_row = 8 + 4 + 4 + 8;
+    std::size_t first_entry = first_row + 8 + 4;
+    int32_t nnz;
+    memcpy(&nnz, content.data() + first_row + 8, sizeof(nnz));
+    VRSGD_CHECK(nnz > 0);
+
+    std::vector<std::string> damaged;
+    damaged.push_back(content.substr(0, content.size() - 4));
+    std::string bad = content;
+    int64_t data_num = -1;
+    memcpy(&bad[first_row - 8], &data_num, sizeof(data_num));
+    damaged.push_back(bad);
+    for (int32_t val : {-1, feature_num + 1}) {
+        bad = content;
+        memcpy(&bad[first_row + 8], &val, sizeof(val));
+        damaged.push_back(bad);
+    }
+    for (int32_t val : {-1, feature_num}) {
+        bad = content;
+        memcpy(&bad[first_entry], &val, sizeof(val));
+        damaged.push_back(bad);
+    }
+
+    for (const auto& file : damaged) {
+        write_file(filename, file);
+        VRSGD_CHECK(VRSGD::read_binary(loaded, filename) == -1);
+        VRSGD_CHECK(loaded.size() == data_points.size());
+    }
+
+    std::remove(filename.c_str());
+}
+
+}
+
+int main() {
+    test_model();
+    test_saga_state();
+    test_binary<true>();
+    test_binary<false>();
+    return VRSGD::test_result();
+}
@@ -0,0 +1,224 @@
+// Known-answer vectors of the generators and the draw sequences of Sampler,
+// which fix the rows every seeded run trains on.
+
+#include <lib/random.hpp>
+#include <lib/sampler.hpp>
+
+#include "check.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+
+// Reference xoshiro256++ step on a raw state
+uint64_t xoshiro_next(uint64_t* s) {
+    auto rotl = [](uint64_t x, int k) { return (x << k) | (x >> (64 - k)); };
+    uint64_t res = rotl(s[0] + s[3], 23) + s[0];
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return res;
+}
+
+void test_splitmix64() {
+    // splitmix64.c by Vigna, seeded with 1234567
+    static const uint64_t expected[] = {6457827717110365317ULL, 3203168211198807973ULL, 9817491932198370423ULL,
+                                        4593380528125082431ULL, 16408922859458223821ULL};
+    VRSGD::SplitMix64 gen(1234567);
+    for (uint64_t val : expected) {
+        VRSGD_CHECK(gen() == val);
+    }
+}
+
+void test_xoshiro256() {
+    // xoshiro256plusplus.c by Blackman and Vigna, state {1, 2, 3, 4}
+    static const uint64_t expected[] = {41943041ULL, 58720359ULL, 3588806011781223ULL, 3591011842654386ULL,
+                                        9228616714210784205ULL, 9973669472204895162ULL, 14011001112246962877ULL,
+                                        12406186145184390807ULL, 15849039046786891736ULL, 10450023813501588000ULL};
+    uint64_t s[4] = {1, 2, 3, 4};
+    for (uint64_t val : expected) {
+        VRSGD_CHECK(xoshiro_next(s) == val);
+    }
+
+    // Xoshiro256(seed) starts from four SplitMix64 outputs
+    VRSGD::SplitMix64 sm(42);
+    uint64_t state[4] = {sm(), sm(), sm(), sm()};
+    VRSGD::Xoshiro256 gen(42);
+    for (int i = 0; i < 100; i++) {
+        VRSGD_CHECK(gen() == xoshiro_next(state));
+    }
+}
+
+// 256 x 256 matrix over GF(2) by columns, each column a xoshiro256 state
+struct BitMatrix {
+    uint64_t col[256][4];
+
+    void apply(const uint64_t* v, uint64_t* res) const {
+        res[0] = res[1] = res[2] = res[3] = 0;
+        for (int k = 0; k < 256; k++) {
+            if (v[k / 64] >> (k % 64) & 1) {
+                for (int w = 0; w < 4; w++) {
+                    res[w] ^= col[k][w];
+                }
+            }
+        }
+    }
+};
+
+void test_xoshiro256_jump() {
+    // jump() must equal 2^128 steps: square the state transition 128 times
+    BitMatrix step;
+    for (int k = 0; k < 256; k++) {
+        uint64_t s[4] = {0, 0, 0, 0};
+        s[k / 64] = uint64_t(1) << (k % 64);
+        xoshiro_next(s);
+        std::copy(s, s + 4, step.col[k]);
+    }
+    for (int i = 0; i < 128; i++) {
+        BitMatrix square;
+        for (int k = 0; k < 256; k++) {
+            step.apply(step.col[k], square.col[k]);
+        }
+        step = square;
+    }
+
+    VRSGD::SplitMix64 sm(42);
+    uint64_t state[4] = {sm(), sm(), sm(), sm()};
+    for (uint64_t stream = 1; stream <= 2; stream++) {
+        uint64_t jumped[4];
+        step.apply(state, jumped);
+        std::copy(jumped, jumped + 4, state);
+
+        VRSGD::Xoshiro256 gen(42, stream);
+        uint64_t s[4] = {state[0], state[1], state[2], state[3]};
+        for (int i = 0; i < 100; i++) {
+            VRSGD_CHECK(gen() == xoshiro_next(s));
+        }
+    }
+}
+
+void test_philox4x32() {
+    // kat_vectors of Random123 for philox4x32_10: counter, key, output. The
+    // key is the seed, counter words 2 and 3 the stream and words 0 and 1
+    // the block of seek()
+    static const uint32_t kat[][10] = {
+        {0, 0, 0, 0, 0, 0, 0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8},
+        {0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+         0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd},
+        {0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344, 0xa4093822, 0x299f31d0,
+         0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1},
+    };
+    for (const auto& v : kat) {
+        auto pair = [](uint32_t lo, uint32_t hi) { return ((uint64_t)hi << 32) | lo; };
+        VRSGD::Philox4x32 gen(pair(v[4], v[5]), pair(v[2], v[3]));
+        gen.seek(pair(v[0], v[1]));
+        VRSGD_CHECK(gen() == pair(v[6], v[7]));
+        VRSGD_CHECK(gen() == pair(v[8], v[9]));
+    }
+
+    // Every block holds two draws, seek(n) continues at draw 2 n
+    VRSGD::Philox4x32 gen(42, 3);
+    std::vector<uint64_t> draws(20);
+    for (auto& draw : draws) {
+        draw = gen();
+    }
+    gen.seek(7);
+    VRSGD_CHECK(gen() == draws[14]);
+    VRSGD_CHECK(gen() == draws[15]);
+    VRSGD_CHECK(VRSGD::Philox4x32(42, 4)() != draws[0]);
+}
+
+void test_bounded_rand() {
+    VRSGD::Xoshiro256 gen(7);
+    std::vector<int> counts(10);
+    for (int i = 0; i < 100000; i++) {
+        uint32_t x = VRSGD::bounded_rand(gen, 10);
+        if (!VRSGD_CHECK(x < 10)) {
+            return;
+        }
+        counts[x]++;
+    }
+    for (int count : counts) {
+        VRSGD_CHECK(std::abs(count - 10000) < 500);
+    }
+
+    for (int i = 0; i < 1000; i++) {
+        double u = VRSGD::uniform_real(gen);
+        VRSGD_CHECK(u >= 0 && u < 1);
+    }
+}
+
+std::vector<int> draws(int sample_opt, int data_num, int num, int block_size = 1024) {
+    VRSGD::Sampler<> sampler(sample_opt, 1, block_size);
+    sampler.init(data_num);
+    std::vector<int> res(num);
+    for (int& idx : res) {
+        idx = sampler.next();
+    }
+    return res;
+}
+
+void test_sampler() {
+    // First draws of seed 1 over 10 rows; a change here changes every
+    // seeded training run
+    VRSGD_CHECK(draws(0, 10, 10) == std::vector<int>({8, 7, 1, 7, 1, 5, 9, 5, 0, 1}));
+    VRSGD_CHECK(draws(1, 10, 10) == std::vector<int>({4, 7, 9, 3, 2, 1, 5, 0, 6, 8}));
+    VRSGD_CHECK(draws(3, 10, 10, 4) == std::vector<int>({1, 3, 2, 0, 4, 5, 7, 6, 9, 8}));
+
+    // Cyclic visits the rows in order
+    std::vector<int> cyclic = draws(2, 5, 10);
+    for (int i = 0; i < 10; i++) {
+        VRSGD_CHECK(cyclic[i] == i % 5);
+    }
+
+    // Reshuffling and block shuffling visit every row once per epoch, block
+    // shuffling stays within one block for block_size draws
+    for (int sample_opt : {1, 3}) {
+        std::vector<int> epochs = draws(sample_opt, 100, 300, 16);
+        for (int e = 0; e < 3; e++) {
+            std::vector<int> epoch(epochs.begin() + 100 * e, epochs.begin() + 100 * (e + 1));
+            std::sort(epoch.begin(), epoch.end());
+            for (int i = 0; i < 100; i++) {
+                VRSGD_CHECK(epoch[i] == i);
+            }
+        }
+        if (sample_opt == 3) {
+            for (int i = 0; i < 16; i++) {
+                VRSGD_CHECK(epochs[i] / 16 == epochs[0] / 16);
+            }
+        }
+    }
+
+    // focus() draws the new rows with the given probability and weights
+    // every row by 1 / (n p_i)
+    VRSGD::Sampler<> sampler(0, 1);
+    sampler.focus(90, 0.5);
+    sampler.init(100);
+    int num_new = 0;
+    for (int i = 0; i < 100000; i++) {
+        num_new += sampler.next() >= 90;
+    }
+    VRSGD_CHECK(std::abs(num_new - 55000) < 1000);
+    VRSGD_CHECK_NEAR(sampler.weight(0), 2., 1e-12);
+    VRSGD_CHECK_NEAR(sampler.weight(95), 1. / 5.5, 1e-12);
+    VRSGD_CHECK_NEAR(sampler.min_sample_ratio(100), 0.5, 1e-12);
+}
+
+}
+
+int main() {
+    test_splitmix64();
+    test_xoshiro256();
+    test_xoshiro256_jump();
+    test_philox4x32();
+    test_bounded_rand();
+    test_sampler();
+    return VRSGD::test_result();
+}
@@ -0,0 +1,239 @@
+// Every solver on a small synthetic problem must get close to the optimum
+// found by full proximal gradient descent.
+
+#include <lib/vector.hpp>
+#include <lib/sampler.hpp>
+#include <lib/step_size.hpp>
+#include <lib/synthetic.hpp>
+#include <lib/transport.hpp>
+#include <algo/saga.hpp>
+#include <algo/svrg.hpp>
+#include <algo/async_saga.hpp>
+#include <algo/loopless_svrg.hpp>
+#include <algo/sarah.hpp>
+#include <algo/katyusha.hpp>
+#include <algo/sdca.hpp>
+#include <algo/dist_svrg.hpp>
+#include <problem/ridge_regression.hpp>
+#include <problem/lasso_regression.hpp>
+#include <problem/logistic_regression.hpp>
+
+#include "check.hpp"
+
+#include <cstdio>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+
+typedef VRSGD::LabeledPoint<VRSGD::Vector<double, true>, double> LabeledPoint_;
+
+const int data_num = 400;
+const int feature_num = 20;
+const double lambda = 1e-2;
+
+bool quiet(int, double) { return true; }
+
+std::vector<LabeledPoint_> make_data(int label_opt) {
+    std::vector<LabeledPoint_> data_points;
+    VRSGD::make_synthetic(data_points, data_num, feature_num, 0.5, 0.1, label_opt, 1);
+    return data_points;
+}
+
+// Optimal objective by proximal gradient descent on the full gradient
+template <typename ProblemT>
+double optimum(ProblemT& problem, int w_feature_num) {
+    double alpha = 1. / VRSGD::max_smoothness(problem);
+    VRSGD::DenseVector<double> w(w_feature_num);
+    for (int iter = 0; iter < 5000; iter++) {
+        VRSGD::DenseVector<double> grad(w_feature_num);
+        for (int i = 0; i < problem.size(); i++) {
+            grad += problem.grad_func(w, i) / problem.size();
+        }
+        w = problem.prox_func(w - alpha * grad, alpha, lambda);
+    }
+    return problem.cost_func(w);
+}
+
+template <typename ProblemT>
+void check_solver(const char* name, ProblemT& problem, const VRSGD::DenseVector<double>& w, double opt, double tol) {
+    double gap = problem.cost_func(w) - opt;
+    printf("%s: %.3g above the optimum\n", name, gap);
+    if (!VRSGD_CHECK(gap >= -1e-9 && gap < tol)) {
+        fprintf(stderr, "%s does not converge\n", name);
+    }
+}
+
+// Runs every solver on make_problem(rows), which builds the problem over a
+// DataView of data_points
+template <typename MakeProblem>
+void test_solvers(const char* problem_name, const std::vector<LabeledPoint_>& data_points, MakeProblem make_problem,
+                  int w_feature_num, double tol) {
+    printf("%s\n", problem_name);
+    auto problem = make_problem(VRSGD::DataView<LabeledPoint_>(data_points));
+    double opt = optimum(problem, w_feature_num);
+    double alpha = VRSGD::smoothness_step(problem);
+    int epochs = 30;
+    int num_inner_iter = 2 * data_num;
+
+    check_solver("saga", problem,
+                 VRSGD::saga_train<double, double, true>(problem, alpha, lambda, 1, epochs * data_num, w_feature_num,
+                                                         data_num, VRSGD::Sampler<>(0, 1), quiet),
+                 opt, tol);
+    check_solver("saga reshuffling", problem,
+                 VRSGD::saga_train<double, double, true>(problem, alpha, lambda, 1, epochs * data_num, w_feature_num,
+                                                         data_num, VRSGD::Sampler<>(1, 1), quiet),
+                 opt, tol);
+    check_solver("svrg", problem,
+                 VRSGD::svrg_train<double, double, true>(problem, alpha, lambda, 1, epochs / 2, num_inner_iter,
+                                                         w_feature_num, 0, num_inner_iter, VRSGD::Sampler<>(0, 1),
+                                                         quiet),
+                 opt, tol);
+    check_solver("loopless_svrg", problem,
+                 VRSGD::loopless_svrg_train<double, double, true>(problem, alpha, lambda, 1, epochs * data_num,
+                                                                  w_feature_num, 0, data_num, VRSGD::Sampler<>(0, 1),
+                                                                  quiet),
+                 opt, tol);
+    check_solver("sarah", problem,
+                 VRSGD::sarah_train<double, double, true>(problem, alpha, lambda, 1, epochs / 2, num_inner_iter,
+                                                          w_feature_num, 0, num_inner_iter, VRSGD::Sampler<>(0, 1),
+                                                          quiet),
+                 opt, tol);
+    check_solver("katyusha", problem,
+                 VRSGD::katyusha_train<double, double, true>(problem, 1. / (3. * alpha), 0, lambda, 1, epochs / 2,
+                                                             num_inner_iter, w_feature_num, num_inner_iter,
+                                                             VRSGD::Sampler<>(0, 1), quiet),
+                 opt, tol);
+    check_solver("async_saga", problem,
+                 VRSGD::async_saga_train<double, double, true>(problem, alpha, lambda, 1, epochs * data_num,
+                                                               w_feature_num, data_num, 2, 4, VRSGD::Sampler<>(0, 1),
+                                                               quiet),
+                 opt, tol);
+
+    // Two workers on the halves of the rows, every one of them returns w
+    std::vector<int> rows[2];
+    for (int i = 0; i < problem.size(); i++) {
+        rows[i % 2].push_back(i);
+    }
+    VRSGD::LocalGroup group(2);
+    VRSGD::DenseVector<double> dist_w[2];
+    std::vector<std::thread> threads;
+    for (int r = 0; r < 2; r++) {
+        threads.emplace_back([&, r]() {
+            auto shard = make_problem(VRSGD::DataView<LabeledPoint_>(data_points, rows[r]));
+            VRSGD::LocalTransport transport(group, r);
+            dist_w[r] = VRSGD::dist_svrg_train<double, double, true>(shard, transport, alpha, lambda, 1, epochs / 2,
+                                                                     num_inner_iter / 2, w_feature_num, 0,
+                                                                     num_inner_iter, VRSGD::Sampler<>(0, 1, 1024, r),
+                                                                     quiet);
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    check_solver("dist_svrg", problem, dist_w[0], opt, tol);
+}
+
+void test_ridge() {
+    auto data_points = make_data(0);
+    for (bool intercept : {false, true}) {
+        auto make_problem = [&](const VRSGD::DataView<LabeledPoint_>& rows) {
+            return VRSGD::RidgeRegression<true>(rows, lambda, intercept);
+        };
+        int w_feature_num = intercept ? feature_num + 1 : feature_num;
+        test_solvers(intercept ? "ridge, intercept" : "ridge", data_points, make_problem, w_feature_num, 1e-8);
+
+        // sdca has no intercept
+        auto problem = make_problem(data_points);
+        if (!intercept) {
+            double gap;
+            auto w = VRSGD::sdca_train<double, double, true>(problem, 0, 30, feature_num, 1e-10,
+                                                             VRSGD::Sampler<>(0, 1), quiet, &gap);
+            check_solver("sdca", problem, w, optimum(problem, w_feature_num), 1e-8);
+            VRSGD_CHECK(gap < 1e-8);
+        } else {
+            bool rejected = false;
+            try {
+                VRSGD::sdca_train<double, double, true>(problem, 0, 30, w_feature_num, 1e-10, VRSGD::Sampler<>(0, 1),
+                                                        quiet);
+            } catch (const std::invalid_argument&) {
+                rejected = true;
+            }
+            VRSGD_CHECK(rejected);
+        }
+    }
+}
+
+// No inner iterations must leave w as it is rather than average nothing
+void test_svrg_no_inner_iter() {
+    auto data_points = make_data(0);
+    VRSGD::RidgeRegression<true> problem(data_points, lambda);
+    for (int w_tidle_opt : {0, 1, 2}) {
+        auto w = VRSGD::svrg_train<double, double, true>(problem, 0.1, lambda, 1, 3, 0, feature_num, w_tidle_opt, 1,
+                                                         VRSGD::Sampler<>(0, 1), quiet);
+        VRSGD_CHECK(w.norm_sqr() == 0);
+    }
+}
+
+// Stopping early inside the inner loop still returns the same w everywhere
+void test_dist_svrg_early_stop() {
+    auto data_points = make_data(0);
+    std::vector<int> rows[2];
+    for (int i = 0; i < data_num; i++) {
+        rows[i % 2].push_back(i);
+    }
+    VRSGD::LocalGroup group(2);
+    VRSGD::DenseVector<double> dist_w[2];
+    std::vector<std::thread> threads;
+    for (int r = 0; r < 2; r++) {
+        threads.emplace_back([&, r]() {
+            VRSGD::RidgeRegression<true> shard(VRSGD::DataView<LabeledPoint_>(data_points, rows[r]), lambda);
+            VRSGD::LocalTransport transport(group, r);
+            dist_w[r] = VRSGD::dist_svrg_train<double, double, true>(
+                shard, transport, 0.1, lambda, 1, 3, data_num, feature_num, 0, 1, VRSGD::Sampler<>(0, 1, 1024, r),
+                [](int num_effective_pass, double) { return num_effective_pass < 5; });
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (int j = 0; j < feature_num; j++) {
+        VRSGD_CHECK(dist_w[0][j] == dist_w[1][j]);
+    }
+}
+
+void test_lasso() {
+    auto data_points = make_data(0);
+    auto make_problem = [&](const VRSGD::DataView<LabeledPoint_>& rows) {
+        return VRSGD::LassoRegression<true>(rows, lambda);
+    };
+    test_solvers("lasso", data_points, make_problem, feature_num, 1e-6);
+
+    auto problem = make_problem(data_points);
+    double l2_smoothing = 1e-4;
+    auto w = VRSGD::sdca_train<double, double, true>(problem, l2_smoothing, 30, feature_num, 1e-10,
+                                                     VRSGD::Sampler<>(0, 1), quiet);
+    // sdca solves the lasso plus l2_smoothing / 2 ||w||^2
+    check_solver("sdca", problem, w, optimum(problem, feature_num), l2_smoothing / 2. * w.norm_sqr() + 1e-8);
+}
+
+void test_logistic() {
+    auto data_points = make_data(2);
+    auto make_problem = [&](const VRSGD::DataView<LabeledPoint_>& rows) {
+        return VRSGD::LogisticRegression<true>(rows, lambda);
+    };
+    // katyusha with sigma 0 converges sublinearly without strong convexity
+    test_solvers("logistic", data_points, make_problem, feature_num + 1, 1e-5);
+}
+
+}
+
+int main() {
+    test_ridge();
+    test_svrg_no_inner_iter();
+    test_dist_svrg_early_stop();
+    test_lasso();
+    test_logistic();
+    return VRSGD::test_result();
+}
@@ -0,0 +1,780 @@
+// Configurable training driver, replacing the hard-coded settings of the
+// per-problem drivers:
+//
+//   ./train --problem lasso --solver svrg --data ./datasets/covtype.binary --normalize 1 --label_threshold 1.5 --alpha 0.4 --lambda 1e-4
+//   ./train --config covtype_lasso.conf --epochs 20
+//
+// --data synthetic:n:d:density generates a dataset with lib/synthetic.hpp
+// instead of reading one.
+//
+// A config file holds one "key = value" per line, '#' starts a comment, and
+// command line options override it. See Options below for the keys.
+
+#include <lib/vector.hpp>
+#include <lib/utils.hpp>
+#include <lib/sampler.hpp>
+#include <lib/synthetic.hpp>
+#include <lib/model.hpp>
+#include <lib/step_size.hpp>
+#include <lib/preprocess.hpp>
+#include <lib/numa.hpp>
+#include <lib/cross_validation.hpp>
+#include <lib/sweep.hpp>
+#include <lib/trace.hpp>
+#include <algo/saga.hpp>
+#include <algo/svrg.hpp>
+#include <algo/async_saga.hpp>
+#include <algo/loopless_svrg.hpp>
+#include <algo/sarah.hpp>
+#include <algo/katyusha.hpp>
+#include <algo/sdca.hpp>
+#include <algo/multi_saga.hpp>
+#include <problem/ridge_regression.hpp>
+#include <problem/lasso_regression.hpp>
+#include <problem/logistic_regression.hpp>
+#include <problem/multi_output.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+typedef VRSGD::LabeledPoint<VRSGD::Vector<double, true>, double> LabeledPoint_;
+typedef VRSGD::DataView<LabeledPoint_> DataView_;
+
+class Options {
+   public:
+    Options() {
+        values = {
+            {"problem", "ridge"},       // ridge, ridge_prox, lasso or logistic
+            {"solver", "saga"},         // saga, svrg, async_saga, loopless_svrg, sarah, katyusha or sdca
+            {"data", ""},
+            {"format", "libsvm"},       // libsvm or binary
+            {"feature_num", "0"},       // 0: largest feature index in the data, 2^hash_bits when hashing
+            {"hash_bits", "0"},         // libsvm: hash the feature ids into 2^hash_bits features, see lib/hashing.hpp
+            {"hash_seed", "0"},
+            {"threads", "1"},           // threads used for parsing and preprocessing, and the workers of async_saga
+            {"alpha", "0"},             // 0: 1 / (3 L) from the per-sample smoothness
+            {"step_opt", "0"},          // 0: constant alpha, 1: Barzilai-Borwein (svrg), 2: backtracking
+            {"lambda", "1e-4"},
+            {"intercept", "0"},         // ridge, ridge_prox, lasso: fit an unregularized intercept (logistic always does)
+            {"batch_size", "1"},
+            {"epochs", "10"},           // saga, loopless_svrg: passes over the data, others: outer iterations
+            {"num_inner_iter", "0"},    // svrg, sarah, katyusha, 0: 2 * data_num / batch_size
+            {"w_tidle_opt", "0"},       // svrg, see algo/svrg.hpp
+            {"snapshot_prob", "0"},     // loopless_svrg, see algo/loopless_svrg.hpp
+            {"inner_stop_ratio", "0"},  // sarah, see algo/sarah.hpp
+            {"sigma", "0"},             // katyusha, see algo/katyusha.hpp
+            {"l2_smoothing", "1e-5"},   // sdca with lasso, see algo/sdca.hpp
+            {"gap_eps", "1e-8"},        // sdca, stop at this duality gap
+            {"staleness", "4"},         // async_saga, see algo/async_saga.hpp
+            {"numa", "0"},              // async_saga: pin the workers and place their rows on their NUMA nodes
+            {"sample_opt", "0"},        // see lib/sampler.hpp
+            {"block_size", "0"},        // sample_opt 3, 0: rows fitting into 1MB
+            {"seed", "0"},              // 0: nondeterministic
+            {"huge_pages", "0"},        // put buffers of 2MB and more on transparent huge pages
+            {"sample_period", "0"},     // 0: once per epoch
+            {"shuffle", "0"},           // permute the rows once after loading
+            {"normalize", "0"},         // scale every row to unit L2 norm
+            {"standardize", "0"},       // scale every feature to unit root mean square
+            {"label_threshold", ""},    // map y < threshold to -1 (0 for logistic) and the rest to 1
+            {"scale_target", "0"},      // divide y by max |y|
+            {"save_binary", ""},        // write the loaded data in the binary format
+            {"model", ""},              // write the trained model, see lib/model.hpp
+            {"outputs", ""},            // ovr: one model per distinct label, trained together; model.<label> each
+            {"trace", ""},              // built with -DVRSGD_TRACE: print the time per solver phase, write a Chrome trace
+            {"trace_perf", "0"},        // with --trace: perf_event_open counters per phase
+            {"trace_events", "100000"}, // with --trace: phases kept per thread in the Chrome trace
+            {"init_model", ""},         // saga, svrg: start from this model, e.g. the one trained before --new_data arrived
+            {"new_data", ""},           // rows appended to --data since the last training, same format and features
+            {"new_data_prob", "0.5"},   // with --new_data: probability of sampling a new row, see Sampler::focus()
+            {"saga_state", ""},         // saga: resume from this state if the file exists, then write the final state to it
+            {"cv_folds", "0"},          // > 1: k-fold cross-validation on --threads threads instead of training a model
+            {"sweep_alpha", ""},        // comma-separated grids, any given: sweep saga or svrg over their product
+            {"sweep_lambda", ""},       // instead of training a model, see sweep() below
+            {"sweep_batch_size", ""},
+            {"sweep_num_inner_iter", ""},
+            {"sweep_eta", "3"},         // keep the best 1 / sweep_eta of the jobs at every rung, see lib/sweep.hpp
+            {"sweep_min_epochs", "1"},  // passes over the data before the first rung
+            {"sweep_jobs", "0"},        // concurrent jobs, 0: as many as fit into the cores and memory
+        };
+    }
+
+    bool parse_file(const std::string& filename) {
+        std::ifstream fs(filename);
+        if (!fs) {
+            return false;
+        }
+
+        std::string line;
+        while (std::getline(fs, line)) {
+            line = line.substr(0, line.find('#'));
+            auto pos = line.find('=');
+            if (pos == std::string::npos) {
+                continue;
+            }
+            set(trim(line.substr(0, pos)), trim(line.substr(pos + 1)));
+        }
+        return true;
+    }
+
+    bool parse_args(int argc, char** argv) {
+        for (int i = 1; i < argc; i += 2) {
+            std::string key = argv[i];
+            if (key.compare(0, 2, "--") != 0 || i + 1 == argc) {
+                fprintf(stderr, "expected --key value, got %s\n", argv[i]);
+                return false;
+            }
+            if (key == "--config") {
+                if (!parse_file(argv[i + 1])) {
+                    fprintf(stderr, "cannot read config %s\n", argv[i + 1]);
+                    return false;
+                }
+            }
+        }
+        for (int i = 1; i < argc; i += 2) {
+            if (std::string(argv[i]) != "--config") {
+                set(argv[i] + 2, argv[i + 1]);
+            }
+        }
+        return !has_error;
+    }
+
+    inline const std::string& get(const std::string& key) { return values[key]; }
+
+    inline int get_int(const std::string& key) { return std::stoi(values[key]); }
+
+    inline double get_double(const std::string& key) { return std::stod(values[key]); }
+
+    void set(const std::string& key, const std::string& value) {
+        if (values.count(key) == 0) {
+            fprintf(stderr, "unknown option %s\n", key.c_str());
+            has_error = true;
+        }
+        values[key] = value;
+    }
+
+   private:
+    static std::string trim(const std::string& s) {
+        auto begin = s.find_first_not_of(" \t\r");
+        auto end = s.find_last_not_of(" \t\r");
+        return begin == std::string::npos ? "" : s.substr(begin, end - begin + 1);
+    }
+
+    std::map<std::string, std::string> values;
+    bool has_error = false;
+};
+
+// Warm start of --init_model and --saga_state
+struct Incremental {
+    VRSGD::DenseVector<double> w_init;  // empty: start from 0
+    int first_new = 0;                  // the rows before it were trained on before
+};
+
+template <typename ProblemT>
+VRSGD::DenseVector<double> train(ProblemT& problem, Options& options, int w_feature_num,
+                                 const VRSGD::ReportFunc& report = VRSGD::print_progress,
+                                 const Incremental* incremental = nullptr) {
+    int data_num = problem.size();
+    int batch_size = options.get_int("batch_size");
+    int epochs = options.get_int("epochs");
+
+    double lambda = options.get_double("lambda");
+
+    uint64_t seed = std::stoull(options.get("seed"));
+    if (seed == 0) {
+        seed = std::random_device()();
+    }
+    VRSGD::Sampler<> sampler(options.get_int("sample_opt"), seed, options.get_int("block_size"));
+    if (incremental && incremental->first_new < data_num) {
+        sampler.focus(incremental->first_new, options.get_double("new_data_prob"));
+    }
+
+    double alpha = options.get_double("alpha");
+    if (options.get_int("step_opt") == 2) {
+        // Line search at w = 0 on a sample, a third of it for the VR solvers
+        alpha = VRSGD::backtracking_step(problem, VRSGD::DenseVector<double>(w_feature_num), alpha, 1000,
+                                         sampler.get_gen()) / 3.;
+        printf("alpha: %.15lf\n", alpha);
+    } else if (alpha <= 0) {
+        alpha = VRSGD::smoothness_step(problem, options.get_int("sample_opt"));
+        printf("alpha: %.15lf\n", alpha);
+    }
+    if (sampler.min_sample_ratio(data_num) < 1) {
+        // Sampler::focus() weights the old rows by up to 1 / min_sample_ratio
+        alpha *= sampler.min_sample_ratio(data_num);
+        printf("alpha: %.15lf\n", alpha);
+    }
+
+    if (options.get("solver") == "saga" && incremental) {
+        int sample_period = options.get_int("sample_period") > 0 ? options.get_int("sample_period") : data_num / batch_size;
+        const std::string& state_file = options.get("saga_state");
+        VRSGD::SagaStateOf<double, ProblemT> state;
+        if (state_file == "" || !VRSGD::load_saga_state(state, state_file)) {
+            state.w = incremental->w_init;
+        } else if (options.get("init_model") != "") {
+            fprintf(stderr, "init_model is ignored, %s holds w\n", state_file.c_str());
+        }
+        if ((int)state.table.size() != incremental->first_new && !state.table.empty()) {
+            fprintf(stderr, "%s holds %d rows, not the %d of --data; computing the table again\n", state_file.c_str(),
+                    (int)state.table.size(), incremental->first_new);
+            state.table.clear();
+        }
+
+        VRSGD::saga_train_incremental<double, double, true>(problem, alpha, lambda, batch_size,
+                                                            epochs * (data_num / batch_size), w_feature_num,
+                                                            std::max(sample_period, 1), state, sampler, report);
+        if (state_file != "" && !VRSGD::save_saga_state(state, state_file)) {
+            fprintf(stderr, "cannot write saga state %s\n", state_file.c_str());
+        }
+        return state.w;
+    } else if (options.get("solver") == "saga") {
+        int sample_period = options.get_int("sample_period") > 0 ? options.get_int("sample_period") : data_num / batch_size;
+        return VRSGD::saga_train<double, double, true>(problem, alpha, lambda, batch_size, epochs * (data_num / batch_size),
+                                                w_feature_num, std::max(sample_period, 1), sampler, report);
+    } else if (options.get("solver") == "async_saga") {
+        int sample_period = options.get_int("sample_period") > 0 ? options.get_int("sample_period") : data_num / batch_size;
+        VRSGD::NumaTopology topology;
+        return VRSGD::async_saga_train<double, double, true>(problem, alpha, lambda, batch_size, epochs * (data_num / batch_size),
+                                                      w_feature_num, std::max(sample_period, 1), options.get_int("threads"),
+                                                      options.get_int("staleness"), sampler, report,
+                                                      options.get_int("numa") ? &topology : nullptr);
+    } else if (options.get("solver") == "loopless_svrg") {
+        int sample_period = options.get_int("sample_period") > 0 ? options.get_int("sample_period") : data_num / batch_size;
+        return VRSGD::loopless_svrg_train<double, double, true>(problem, alpha, lambda, batch_size, epochs * (data_num / batch_size),
+                                                         w_feature_num, options.get_double("snapshot_prob"),
+                                                         std::max(sample_period, 1), sampler, report);
+    }
+
+    // At least 1, even for a batch_size above 2 * data_num
+    int num_inner_iter = std::max(1, options.get_int("num_inner_iter") > 0 ? options.get_int("num_inner_iter")
+                                                                           : 2 * data_num / batch_size);
+    int sample_period = options.get_int("sample_period") > 0 ? options.get_int("sample_period") : num_inner_iter;
+    if (options.get("solver") == "sarah") {
+        return VRSGD::sarah_train<double, double, true>(problem, alpha, lambda, batch_size, epochs, num_inner_iter,
+                                                 w_feature_num, options.get_double("inner_stop_ratio"),
+                                                 std::max(sample_period, 1), sampler, report);
+    } else if (options.get("solver") == "katyusha") {
+        // alpha is the step 1 / (3 L) of the other solvers
+        return VRSGD::katyusha_train<double, double, true>(problem, 1. / (3. * alpha), options.get_double("sigma"), lambda,
+                                                    batch_size, epochs, num_inner_iter, w_feature_num,
+                                                    std::max(sample_period, 1), sampler, report);
+    } else {
+        return VRSGD::svrg_train<double, double, true>(problem, alpha, lambda, batch_size, epochs, num_inner_iter,
+                                                w_feature_num, options.get_int("w_tidle_opt"), std::max(sample_period, 1),
+                                                sampler, report, options.get_int("step_opt"),
+                                                incremental ? incremental->w_init : VRSGD::DenseVector<double>());
+    }
+}
+
+// Only for the squared-loss problems, see algo/sdca.hpp
+template <typename ProblemT>
+VRSGD::DenseVector<double> train_sdca(ProblemT& problem, Options& options, int w_feature_num,
+                                      const VRSGD::ReportFunc& report = VRSGD::print_progress) {
+    uint64_t seed = std::stoull(options.get("seed"));
+    if (seed == 0) {
+        seed = std::random_device()();
+    }
+    VRSGD::Sampler<> sampler(options.get_int("sample_opt"), seed, options.get_int("block_size"));
+
+    double gap;
+    auto w = VRSGD::sdca_train<double, double, true>(problem, options.get_double("l2_smoothing"), options.get_int("epochs"),
+                                                     w_feature_num, options.get_double("gap_eps"), sampler,
+                                                     report, &gap);
+    printf("duality_gap: %.15g\n", gap);
+    return w;
+}
+
+// Trains --problem over rows, returns its w
+VRSGD::DenseVector<double> train_problem(const DataView_& rows, Options& options, int feature_num,
+                                         const VRSGD::ReportFunc& report = VRSGD::print_progress,
+                                         const Incremental* incremental = nullptr) {
+    const std::string& problem_name = options.get("problem");
+    bool sdca = options.get("solver") == "sdca";
+    double lambda = options.get_double("lambda");
+    bool intercept = options.get_int("intercept");
+    int w_feature_num = intercept ? feature_num + 1 : feature_num;
+    if (problem_name == "ridge") {
+        VRSGD::RidgeRegression<true> problem(rows, lambda, intercept);
+        return sdca ? train_sdca(problem, options, feature_num, report)
+                    : train(problem, options, w_feature_num, report, incremental);
+    } else if (problem_name == "ridge_prox") {
+        VRSGD::RidgeRegressionProx<true> problem(rows, lambda, intercept);
+        return sdca ? train_sdca(problem, options, feature_num, report)
+                    : train(problem, options, w_feature_num, report, incremental);
+    } else if (problem_name == "lasso") {
+        VRSGD::LassoRegression<true> problem(rows, lambda, intercept);
+        return sdca ? train_sdca(problem, options, feature_num, report)
+                    : train(problem, options, w_feature_num, report, incremental);
+    } else {
+        VRSGD::LogisticRegression<true> problem(rows, lambda);
+        return train(problem, options, feature_num + 1, report, incremental);
+    }
+}
+
+// --cv_folds: validation metrics per fold and over all folds
+int cross_validate(const std::vector<LabeledPoint_>& data_points, Options& options, int feature_num) {
+    int num_folds = options.get_int("cv_folds");
+    uint64_t seed = std::stoull(options.get("seed"));
+    if (seed == 0) {
+        seed = std::random_device()();
+    }
+
+    auto results = VRSGD::cross_validate(data_points, num_folds, seed, options.get_int("threads"),
+                                         [&](int, const DataView_& rows) {
+        VRSGD::Model model;
+        model.problem = options.get("problem");
+        model.feature_num = feature_num;
+        model.w = train_problem(rows, options, feature_num, [](int, double) { return true; });
+        return model;
+    });
+
+    for (int fold = 0; fold < num_folds; fold++) {
+        printf("fold %d rows: %lld rmse: %.10f accuracy: %.10f auc: %.10f\n", fold, results[fold].size,
+               results[fold].rmse, results[fold].accuracy, results[fold].auc);
+    }
+    auto mean = VRSGD::average_folds(results);
+    printf("cv rows: %lld rmse: %.10f accuracy: %.10f auc: %.10f\n", mean.size, mean.rmse, mean.accuracy, mean.auc);
+    return 0;
+}
+
+// Values of a comma-separated grid option, the plain option if it is empty
+std::vector<std::string> sweep_grid(Options& options, const std::string& key) {
+    std::vector<std::string> values;
+    std::istringstream ss(options.get("sweep_" + key));
+    std::string value;
+    while (std::getline(ss, value, ',')) {
+        if (value != "") {
+            values.push_back(value);
+        }
+    }
+    if (values.empty()) {
+        values.push_back(options.get(key));
+    }
+    return values;
+}
+
+// Gradient evaluations over data_num after iter iterations, as counted by the
+// report of saga and svrg: the first table or snapshot, and the snapshot of
+// every outer iteration of svrg
+double sweep_epochs(bool saga, long long iter, int batch_size, int num_inner_iter, int data_num) {
+    if (saga) {
+        return 1 + (double)iter * batch_size / data_num;
+    }
+    return 1 + iter / num_inner_iter + 2. * iter * batch_size / data_num;
+}
+
+// Memory of one job: the saga table, dense for ridge, and a few w-sized vectors
+std::size_t sweep_job_bytes(const std::vector<LabeledPoint_>& data_points, Options& options, int feature_num) {
+    std::size_t w_bytes = (feature_num + 1) * (sizeof(double) + 1);
+    if (options.get("solver") != "saga") {
+        return 6 * w_bytes;
+    }
+    std::size_t table_bytes = 0;
+    for (const auto& data_point : data_points) {
+        table_bytes += options.get("problem") == "ridge"
+                           ? (feature_num + 1) * sizeof(double)
+                           : (data_point.x.get_nnz() + 1) * sizeof(VRSGD::FeaValPair<double>);
+    }
+    return table_bytes + 4 * w_bytes;
+}
+
+/*
+ * --sweep_*: trains every point of the product of the grids of alpha,
+ * lambda, batch_size and num_inner_iter as concurrent jobs over the loaded
+ * data, stopping the jobs that diverge or fall behind the others of the same
+ * lambda at the rungs of lib/sweep.hpp. Prints the last objective of every
+ * job, best first for every lambda.
+ */
+int sweep(const std::vector<LabeledPoint_>& data_points, Options& options, int feature_num) {
+    bool saga = options.get("solver") == "saga";
+    if (!saga && options.get("solver") != "svrg") {
+        fprintf(stderr, "sweep supports saga and svrg\n");
+        return 1;
+    }
+    if (options.get_double("sweep_eta") <= 1 || options.get_double("sweep_min_epochs") <= 0) {
+        fprintf(stderr, "sweep_eta must be > 1 and sweep_min_epochs > 0\n");
+        return 1;
+    }
+    if (std::stoull(options.get("seed")) == 0) {
+        // The same sample stream for every job
+        options.set("seed", std::to_string(std::random_device()()));
+    }
+
+    struct Job {
+        Options options;
+        int group;
+        double epochs = 0;
+        double cost = NAN;
+        bool stopped = false;
+    };
+    auto alphas = sweep_grid(options, "alpha");
+    auto lambdas = sweep_grid(options, "lambda");
+    auto batch_sizes = sweep_grid(options, "batch_size");
+    auto inner_iters = saga ? std::vector<std::string>{options.get("num_inner_iter")} : sweep_grid(options, "num_inner_iter");
+    std::vector<Job> jobs;
+    for (std::size_t group = 0; group < lambdas.size(); group++) {
+        for (const auto& alpha : alphas) {
+            for (const auto& batch_size : batch_sizes) {
+                for (const auto& inner_iter : inner_iters) {
+                    Job job{options, (int)group};
+                    job.options.set("alpha", alpha);
+                    job.options.set("lambda", lambdas[group]);
+                    job.options.set("batch_size", batch_size);
+                    job.options.set("num_inner_iter", inner_iter);
+                    jobs.push_back(job);
+                }
+            }
+        }
+    }
+
+    int num_jobs = options.get_int("sweep_jobs");
+    if (num_jobs <= 0) {
+        num_jobs = VRSGD::fit_num_jobs(jobs.size(), sweep_job_bytes(data_points, options, feature_num));
+    }
+    printf("sweep jobs: %d concurrent: %d\n", (int)jobs.size(), num_jobs);
+
+    VRSGD::SuccessiveHalving halving(jobs.size(), lambdas.size(), options.get_double("sweep_min_epochs"),
+                                     options.get_double("sweep_eta"));
+    int data_num = data_points.size();
+    VRSGD::parallel_tasks(jobs.size(), num_jobs, [&](int idx, int) {
+        Job& job = jobs[idx];
+        int batch_size = job.options.get_int("batch_size");
+        int num_inner_iter = job.options.get_int("num_inner_iter") > 0 ? job.options.get_int("num_inner_iter")
+                                                                        : 2 * data_num / batch_size;
+        train_problem(data_points, job.options, feature_num, [&](int iter, double cost) {
+            job.epochs = sweep_epochs(saga, iter, batch_size, std::max(num_inner_iter, 1), data_num);
+            job.cost = cost;
+            job.stopped = !halving.report(idx, job.group, job.epochs, cost);
+            return !job.stopped;
+        });
+    });
+
+    std::vector<int> order(jobs.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+        if (jobs[a].group != jobs[b].group) {
+            return jobs[a].group < jobs[b].group;
+        }
+        // Finite objectives first
+        return std::isfinite(jobs[a].cost) && !(jobs[b].cost <= jobs[a].cost);
+    });
+    for (int idx : order) {
+        Job& job = jobs[idx];
+        printf("alpha: %s lambda: %s batch_size: %s num_inner_iter: %s epochs: %.2f cost: %.15g %s\n",
+               job.options.get("alpha").c_str(), job.options.get("lambda").c_str(),
+               job.options.get("batch_size").c_str(), job.options.get("num_inner_iter").c_str(), job.epochs, job.cost,
+               job.stopped ? "stopped" : "done");
+    }
+    return 0;
+}
+
+// Stores the preprocessing for replay by score. The target scaling is folded
+// into w, so the model predicts in the original units.
+void attach_preprocess(VRSGD::Model& model, const VRSGD::Preprocess& preprocess) {
+    VRSGD::Preprocess replay = preprocess;
+    if (replay.scale_target && model.problem != "logistic") {
+        model.w *= replay.target_scale;
+        replay.scale_target = false;
+        replay.target_scale = 1;
+    }
+    replay.save(model);
+}
+
+// One-vs-rest over the distinct labels with multi_saga_train, one model
+// file per label
+int train_one_vs_rest(const std::vector<LabeledPoint_>& data_points, Options& options, int feature_num,
+                      const VRSGD::Preprocess& preprocess, const VRSGD::FeatureHasher& hasher) {
+    const std::string& problem_name = options.get("problem");
+    int loss_opt = problem_name == "logistic" ? 2 : problem_name == "lasso" ? 1 : 0;
+
+    std::vector<double> classes, labels;
+    VRSGD::one_vs_rest_labels(data_points, loss_opt == 2 ? 0 : -1, classes, labels);
+    printf("outputs: %d\n", (int)classes.size());
+
+    double lambda = options.get_double("lambda");
+    VRSGD::MultiOutputProblem<true> problem(data_points, labels, classes.size(), loss_opt, lambda,
+                                            options.get_int("intercept"));
+    int w_feature_num = problem.has_intercept() ? feature_num + 1 : feature_num;
+
+    int data_num = problem.size();
+    int batch_size = options.get_int("batch_size");
+    uint64_t seed = std::stoull(options.get("seed"));
+    if (seed == 0) {
+        seed = std::random_device()();
+    }
+    VRSGD::Sampler<> sampler(options.get_int("sample_opt"), seed, options.get_int("block_size"));
+
+    double alpha = options.get_double("alpha");
+    if (alpha <= 0) {
+        alpha = VRSGD::smoothness_step(problem, options.get_int("sample_opt"));
+        printf("alpha: %.15lf\n", alpha);
+    }
+    int sample_period = options.get_int("sample_period") > 0 ? options.get_int("sample_period") : data_num / batch_size;
+    auto w = VRSGD::multi_saga_train<double, double, true>(problem, alpha, lambda, batch_size,
+                                                           options.get_int("epochs") * (data_num / batch_size),
+                                                           w_feature_num, std::max(sample_period, 1), sampler);
+
+    if (options.get("model") == "") {
+        return 0;
+    }
+    for (std::size_t k = 0; k < classes.size(); k++) {
+        VRSGD::Model model;
+        model.problem = problem_name;
+        model.feature_num = feature_num;
+        model.w = w.column(k);
+        char label[32];
+        snprintf(label, sizeof(label), "%g", classes[k]);
+        model.meta["positive_label"] = label;
+        attach_preprocess(model, preprocess);
+        hasher.save(model);
+
+        std::string filename = options.get("model") + "." + label;
+        if (!VRSGD::save_model(model, filename)) {
+            fprintf(stderr, "cannot write model %s\n", filename.c_str());
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Appends the rows of path (--format, or synthetic:n:d:density) to
+// data_points. feature_num > 0 is kept, otherwise it receives that of the data.
+bool load_data(std::vector<LabeledPoint_>& data_points, const std::string& path, Options& options, int& feature_num,
+               const VRSGD::FeatureHasher& hasher) {
+    if (path.compare(0, 10, "synthetic:") == 0) {
+        int data_num;
+        int synthetic_feature_num;
+        double density;
+        if (sscanf(path.c_str(), "synthetic:%d:%d:%lf", &data_num, &synthetic_feature_num, &density) != 3) {
+            fprintf(stderr, "expected synthetic:n:d:density, got %s\n", path.c_str());
+            return false;
+        }
+        if (feature_num <= 0) {
+            feature_num = synthetic_feature_num;
+        }
+        // Appended rows come from another seed but the same hidden model
+        uint64_t seed = std::stoull(options.get("seed"));
+        VRSGD::make_synthetic(data_points, data_num, feature_num, density, 0.1, options.get("problem") == "logistic" ? 2 : 0,
+                              seed, data_points.empty() ? 0 : seed + data_points.size());
+    } else if (options.get("format") == "binary") {
+        int binary_feature_num = VRSGD::read_binary(data_points, path);
+        if (binary_feature_num < 0) {
+            fprintf(stderr, "%s is not in the binary format or is corrupt\n", path.c_str());
+            return false;
+        }
+        if (feature_num <= 0) {
+            feature_num = binary_feature_num;
+        } else if (binary_feature_num > feature_num) {
+            fprintf(stderr, "%s has %d features, expected %d\n", path.c_str(), binary_feature_num, feature_num);
+            return false;
+        }
+    } else {
+        int libsvm_feature_num = VRSGD::read_libsvm(data_points, path, std::max(feature_num, 0), options.get_int("threads"),
+                                                    hasher.enabled() ? &hasher : nullptr);
+        // Hashed rows always have hasher.num_buckets() features
+        if (feature_num <= 0 || hasher.enabled()) {
+            feature_num = libsvm_feature_num;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!options.parse_args(argc, argv)) {
+        return 1;
+    }
+    if (options.get("data") == "") {
+        fprintf(stderr, "usage: %s --data <file> [--config <file>] [--<key> <value> ...]\n", argv[0]);
+        return 1;
+    }
+
+    VRSGD::set_huge_pages(options.get_int("huge_pages"));
+
+    const std::string& problem_name = options.get("problem");
+    if (problem_name != "ridge" && problem_name != "ridge_prox" && problem_name != "lasso" && problem_name != "logistic") {
+        fprintf(stderr, "unknown problem %s\n", problem_name.c_str());
+        return 1;
+    }
+    const std::string& solver_name = options.get("solver");
+    if (solver_name != "saga" && solver_name != "svrg" && solver_name != "async_saga" && solver_name != "loopless_svrg" &&
+        solver_name != "sarah" && solver_name != "katyusha" && solver_name != "sdca") {
+        fprintf(stderr, "unknown solver %s\n", solver_name.c_str());
+        return 1;
+    }
+    bool sdca = options.get("solver") == "sdca";
+    if (sdca && (problem_name == "logistic" || options.get_int("intercept"))) {
+        fprintf(stderr, "sdca supports ridge, ridge_prox and lasso without intercept\n");
+        return 1;
+    }
+    if (sdca && (problem_name == "lasso" ? options.get_double("l2_smoothing") : options.get_double("lambda")) <= 0) {
+        fprintf(stderr, "sdca needs lambda > 0, and l2_smoothing > 0 with lasso\n");
+        return 1;
+    }
+    // Preprocessing is fit over all rows, the validation folds included
+    if (options.get_int("cv_folds") > 1 && (options.get_int("standardize") || options.get_int("scale_target"))) {
+        fprintf(stderr, "cv_folds excludes standardize and scale_target\n");
+        return 1;
+    }
+
+#ifdef VRSGD_TRACE
+    VRSGD::trace_config().perf = options.get_int("trace_perf");
+    VRSGD::trace_config().max_events = options.get("trace") != "" ? options.get_int("trace_events") : 0;
+#else
+    if (options.get("trace") != "") {
+        fprintf(stderr, "--trace needs a build with -DVRSGD_TRACE\n");
+        return 1;
+    }
+#endif
+
+    bool is_incremental = options.get("init_model") != "" || options.get("saga_state") != "";
+    if (is_incremental) {
+        if (options.get("solver") != "saga" && (options.get("solver") != "svrg" || options.get("saga_state") != "")) {
+            fprintf(stderr, "init_model supports saga and svrg, saga_state saga\n");
+            return 1;
+        }
+        // The rows must keep their order and the preprocessing must not depend on the new ones
+        if (options.get_int("shuffle") || options.get_int("standardize") || options.get_int("scale_target") ||
+            options.get("outputs") != "" || options.get_int("cv_folds") > 1) {
+            fprintf(stderr, "init_model and saga_state exclude shuffle, standardize, scale_target, outputs and cv_folds\n");
+            return 1;
+        }
+        if (options.get_double("new_data_prob") < 0 || options.get_double("new_data_prob") >= 1) {
+            fprintf(stderr, "new_data_prob must be in [0, 1)\n");
+            return 1;
+        }
+    } else if (options.get("new_data") != "") {
+        fprintf(stderr, "new_data needs init_model or saga_state\n");
+        return 1;
+    }
+
+    VRSGD::FeatureHasher hasher(options.get_int("hash_bits"), std::stoull(options.get("hash_seed")));
+    if (hasher.bits < 0 || hasher.bits > 30) {
+        fprintf(stderr, "hash_bits must be in [0, 30]\n");
+        return 1;
+    }
+
+    Incremental incremental;
+    VRSGD::Model init_model;
+    if (options.get("init_model") != "") {
+        if (!VRSGD::load_model(init_model, options.get("init_model")) || init_model.problem != problem_name) {
+            fprintf(stderr, "%s is not a %s model\n", options.get("init_model").c_str(), problem_name.c_str());
+            return 1;
+        }
+        if (options.get_int("feature_num") <= 0) {
+            options.set("feature_num", std::to_string(init_model.feature_num));
+        }
+    }
+
+    if (hasher.enabled() && options.get_int("feature_num") > 0 && options.get_int("feature_num") != hasher.num_buckets()) {
+        fprintf(stderr, "hash_bits %d gives %d features, not feature_num %d\n", hasher.bits, hasher.num_buckets(),
+                options.get_int("feature_num"));
+        return 1;
+    }
+
+    std::vector<LabeledPoint_> data_points;
+    int feature_num = options.get_int("feature_num");
+    if (!load_data(data_points, options.get("data"), options, feature_num, hasher)) {
+        return 1;
+    }
+    incremental.first_new = data_points.size();
+    if (options.get("new_data") != "" && !load_data(data_points, options.get("new_data"), options, feature_num, hasher)) {
+        return 1;
+    }
+    if (data_points.empty()) {
+        fprintf(stderr, "no data in %s\n", options.get("data").c_str());
+        return 1;
+    }
+    printf("data_num: %d feature_num: %d\n", (int)data_points.size(), feature_num);
+    if (options.get("new_data") != "") {
+        printf("new_rows: %d\n", (int)data_points.size() - incremental.first_new);
+    }
+    if (options.get("init_model") != "") {
+        if (init_model.feature_num != feature_num) {
+            fprintf(stderr, "%s has %d features, the data %d\n", options.get("init_model").c_str(),
+                    init_model.feature_num, feature_num);
+            return 1;
+        }
+        incremental.w_init = init_model.w;
+    }
+    // A w of another size would silently start over from 0
+    int w_feature_num = problem_name == "logistic" || options.get_int("intercept") ? feature_num + 1 : feature_num;
+    if (options.get("init_model") != "" && incremental.w_init.get_feature_num() != w_feature_num) {
+        fprintf(stderr, "%s has a w of %d entries, expected %d\n", options.get("init_model").c_str(),
+                incremental.w_init.get_feature_num(), w_feature_num);
+        return 1;
+    }
+    int state_feature_num = options.get("saga_state") != "" ? VRSGD::saga_state_feature_num(options.get("saga_state")) : -1;
+    if (state_feature_num >= 0 && state_feature_num != w_feature_num) {
+        fprintf(stderr, "%s has a w of %d entries, expected %d\n", options.get("saga_state").c_str(), state_feature_num,
+                w_feature_num);
+        return 1;
+    }
+
+    VRSGD::Preprocess preprocess;
+    preprocess.map_label = options.get("label_threshold") != "";
+    preprocess.label_threshold = preprocess.map_label ? options.get_double("label_threshold") : 0;
+    preprocess.negative = problem_name == "logistic" ? 0 : -1;
+    preprocess.scale_target = options.get_int("scale_target");
+    preprocess.normalize = options.get_int("normalize");
+    preprocess.standardize = options.get_int("standardize");
+    preprocess.fit(data_points, feature_num, options.get_int("threads"));
+    preprocess.apply(data_points, options.get_int("threads"));
+
+    if (options.get_int("shuffle")) {
+        VRSGD::shuffle_data_points(data_points, std::stoull(options.get("seed")));
+    }
+    if (options.get("save_binary") != "") {
+        VRSGD::write_binary(data_points, options.get("save_binary"));
+    }
+    if (options.get_int("sample_opt") == 3 && options.get_int("block_size") <= 0) {
+        options.set("block_size", std::to_string(VRSGD::cache_block_size(data_points)));
+    }
+
+    if (options.get_int("numa") && options.get("solver") == "async_saga") {
+        VRSGD::NumaTopology topology;
+        VRSGD::numa_place_rows(data_points, options.get_int("threads"), topology);
+        printf("numa_nodes: %d\n", topology.num_nodes());
+    }
+
+    if (options.get("sweep_alpha") != "" || options.get("sweep_lambda") != "" ||
+        options.get("sweep_batch_size") != "" || options.get("sweep_num_inner_iter") != "") {
+        return sweep(data_points, options, feature_num);
+    }
+    if (options.get_int("cv_folds") > 1) {
+        return cross_validate(data_points, options, feature_num);
+    }
+    if (options.get("outputs") == "ovr") {
+        return train_one_vs_rest(data_points, options, feature_num, preprocess, hasher);
+    }
+
+    VRSGD::Model model;
+    model.problem = problem_name;
+    model.feature_num = feature_num;
+
+    model.w = train_problem(data_points, options, feature_num, VRSGD::print_progress,
+                            is_incremental ? &incremental : nullptr);
+#ifdef VRSGD_TRACE
+    if (options.get("trace") != "") {
+        VRSGD::print_trace_summary(stdout);
+        if (!VRSGD::write_chrome_trace(options.get("trace").c_str())) {
+            fprintf(stderr, "cannot write trace %s\n", options.get("trace").c_str());
+            return 1;
+        }
+    }
+#endif
+
+    attach_preprocess(model, preprocess);
+    hasher.save(model);
+    if (options.get("model") != "" && !VRSGD::save_model(model, options.get("model"))) {
+        fprintf(stderr, "cannot write model %s\n", options.get("model").c_str());
+        return 1;
+    }
+}